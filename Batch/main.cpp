@@ -0,0 +1,349 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <assimp/Importer.hpp>
+#include <assimp/postprocess.h>
+#include <assimp/scene.h>
+#include "BuildCore.h"
+#include "BuildReport.h"
+#include "CompactVertices.h"
+#include "FrameCost.h"
+#include "TaskGraph.h"
+#include "vendor/cJSON.h"
+#include "vendor/fastlz.h"
+#include "vendor/microtar.h"
+
+using namespace std;
+using namespace UltraEd;
+
+typedef struct
+{
+	string path;
+	string name;
+	bool built;
+	double milliseconds;
+	vector<string> warnings;
+} BatchScene;
+
+// Converts a mesh the same way the editor does when it is imported.
+bool LoadMesh(const string &path, vector<float> &vertices)
+{
+	Assimp::Importer importer;
+	const aiScene *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_ConvertToLeftHanded |
+		aiProcess_OptimizeMeshes);
+	if (scene == NULL) return false;
+
+	vector<aiNode*> nodes(1, scene->mRootNode);
+	vector<float> raw;
+
+	// Only the transform of the node holding the mesh is applied like in CMesh.
+	while (!nodes.empty())
+	{
+		aiNode *node = nodes.back();
+		aiMatrix4x4 transform = node->mTransformation;
+		nodes.pop_back();
+
+		for (unsigned int i = 0; i < node->mNumMeshes; i++)
+		{
+			aiMesh *mesh = scene->mMeshes[node->mMeshes[i]];
+			for (unsigned int j = 0; j < mesh->mNumFaces; j++)
+			{
+				aiFace face = mesh->mFaces[j];
+				for (unsigned int k = 0; k < face.mNumIndices; k++)
+				{
+					unsigned int index = face.mIndices[k];
+					aiVector3D position = transform * mesh->mVertices[index];
+					aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[index] : aiVector3D(0, 1, 0);
+					aiVector3D uv = mesh->HasTextureCoords(0) ? mesh->mTextureCoords[0][index] : aiVector3D(0, 0, 0);
+					float vertex[vertexFloats] = { position.x, position.y, position.z,
+						normal.x, normal.y, normal.z, uv.x, uv.y };
+					raw.insert(raw.end(), vertex, vertex + vertexFloats);
+				}
+			}
+		}
+
+		// Children are pushed in reverse so they are visited in the editor's order.
+		for (unsigned int i = node->mNumChildren; i > 0; i--)
+		{
+			nodes.push_back(node->mChildren[i - 1]);
+		}
+	}
+
+	// The editor builds from its compact copy so round trip through it to match.
+	CCompactVertices compact;
+	compact.Encode(raw.empty() ? NULL : &raw[0], raw.size() / vertexFloats);
+	vertices.resize(compact.GetCount() * vertexFloats);
+	for (size_t i = 0; i < compact.GetCount(); i++)
+	{
+		compact.Decode(i, &vertices[i * vertexFloats]);
+	}
+	return true;
+}
+
+// Expands the compressed scene archive into a plain tar file.
+bool Decompress(const string &path, const string &target)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+	if (file == NULL) return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	rewind(file);
+
+	vector<char> data(size);
+	bool read = size > (long)sizeof(int) && fread(&data[0], 1, size, file) == (size_t)size;
+	fclose(file);
+	if (!read) return false;
+
+	// Compressed data is annotated with the uncompressed size.
+	int uncompressedSize = 0;
+	memcpy(&uncompressedSize, &data[0], sizeof(int));
+	if (uncompressedSize <= 0) return false;
+
+	vector<char> decompressed(uncompressedSize);
+	int bytesDecompressed = fastlz_decompress(&data[sizeof(int)], size - sizeof(int), &decompressed[0],
+		uncompressedSize);
+	if (bytesDecompressed == 0) return false;
+
+	file = fopen(target.c_str(), "wb");
+	if (file == NULL) return false;
+	bool written = fwrite(&decompressed[0], 1, bytesDecompressed, file) == (size_t)bytesDecompressed;
+	fclose(file);
+	return written;
+}
+
+bool ReadVector(cJSON *object, const char *name, float *vector)
+{
+	cJSON *item = cJSON_GetObjectItem(object, name);
+	return item != NULL && sscanf(item->valuestring, "%f %f %f", &vector[0], &vector[1], &vector[2]) == 3;
+}
+
+// Loads the actors of a scene and extracts their resources into the library.
+bool LoadScene(const string &tarPath, const string &libraryPath, vector<BuildActor> &actors)
+{
+	mtar_t tar;
+	mtar_header_t header;
+	if (mtar_open(&tar, tarPath.c_str(), "r") != MTAR_ESUCCESS) return false;
+	if (mtar_find(&tar, "scene.json", &header) != MTAR_ESUCCESS)
+	{
+		mtar_close(&tar);
+		return false;
+	}
+
+	vector<char> contents(header.size + 1, 0);
+	mtar_read_data(&tar, &contents[0], header.size);
+	cJSON *root = cJSON_Parse(&contents[0]);
+	bool loaded = root != NULL;
+
+	cJSON *actor = NULL;
+	cJSON_ArrayForEach(actor, cJSON_GetObjectItem(root, "actors"))
+	{
+		BuildActor target;
+		target.paletteEntries = 0;
+		int type = 0;
+		cJSON *item = cJSON_GetObjectItem(actor, "type");
+		if (item != NULL) sscanf(item->valuestring, "%i", &type);
+		target.type = (ActorType::Value)type;
+
+		item = cJSON_GetObjectItem(actor, "name");
+		if (item != NULL) target.name = item->valuestring;
+		item = cJSON_GetObjectItem(actor, "script");
+		if (item != NULL) target.script = item->valuestring;
+
+		// Converted meshes are named after the actor like the editor does, since actors
+		// sharing a mesh resource can still place and scale it differently.
+		item = cJSON_GetObjectItem(actor, "id");
+		string meshName = item != NULL ? item->valuestring : to_string(actors.size());
+
+		// Textures use the editor's defaults apart from the addressing saved with the model.
+		int address = TextureAddress::Wrap;
+		item = cJSON_GetObjectItem(actor, "textureAddress");
+		if (item != NULL) sscanf(item->valuestring, "%i", &address);
+		TextureOptions textureOptions = { TextureFormat::Auto, true, (TextureAddress::Value)address, MipFilter::Box };
+		target.textureOptions = textureOptions;
+		target.textureLevels = 1;
+		target.lodLevels = 3;
+
+		int isStatic = 0;
+		item = cJSON_GetObjectItem(actor, "static");
+		if (item != NULL) sscanf(item->valuestring, "%i", &isStatic);
+		target.isStatic = isStatic != 0;
+
+		float scale[3] = { 1, 1, 1 };
+		memcpy(target.scale, scale, sizeof(scale));
+		ReadVector(actor, "position", target.position);
+		ReadVector(actor, "scale", target.scale);
+
+		// Match the axis and angle D3DXQuaternionToAxisAngle hands the editor.
+		float x = 0, y = 0, z = 0, w = 1;
+		item = cJSON_GetObjectItem(actor, "rotation");
+		if (item != NULL) sscanf(item->valuestring, "%f %f %f %f", &x, &y, &z, &w);
+		target.axis[0] = x;
+		target.axis[1] = y;
+		target.axis[2] = z;
+		target.angle = 2 * acosf(w) * (180 / 3.141592654f);
+
+		cJSON *resource = NULL;
+		cJSON_ArrayForEach(resource, cJSON_GetObjectItem(actor, "resources"))
+		{
+			const char *fileName = resource->child->valuestring;
+			if (mtar_find(&tar, fileName, &header) != MTAR_ESUCCESS)
+			{
+				loaded = false;
+				continue;
+			}
+
+			vector<char> buffer(header.size + 1, 0);
+			mtar_read_data(&tar, &buffer[0], header.size);
+
+			string path = string(libraryPath).append("/").append(fileName);
+			FILE *file = fopen(path.c_str(), "wb");
+			if (file == NULL)
+			{
+				loaded = false;
+				continue;
+			}
+			fwrite(&buffer[0], 1, header.size, file);
+			fclose(file);
+
+			string key(resource->child->string);
+			if (key == "vertexDataPath")
+			{
+				target.meshPath = string(libraryPath).append("/").append(meshName).append(".rom.vtx");
+				target.loadVertices = [path](vector<float> &vertices) { return LoadMesh(path, vertices); };
+			}
+			else if (key == "textureDataPath")
+			{
+				target.texturePath = path;
+			}
+		}
+
+		actors.push_back(target);
+	}
+
+	cJSON_Delete(root);
+	mtar_close(&tar);
+	return loaded;
+}
+
+// Generates the engine sources and assets of one scene into its own directory.
+bool BuildScene(BatchScene &scene, const string &outputPath)
+{
+	string scenePath = string(outputPath).append("/").append(scene.name);
+	string libraryPath = string(scenePath).append("/library");
+	mkdir(scenePath.c_str(), 0755);
+	mkdir(libraryPath.c_str(), 0755);
+
+	string tarPath = string(scenePath).append("/scene.tar");
+	vector<BuildActor> actors;
+	bool loaded = Decompress(scene.path, tarPath) && LoadScene(tarPath, libraryPath, actors);
+	remove(tarPath.c_str());
+	if (!loaded) return false;
+
+	// Scenes already build in parallel so each one generates on a single thread.
+	CBuildCache cache(string(scenePath).append("/build.cache"));
+	CBuildReport report;
+	if (!CBuildCore::Generate(actors, scenePath.append("/"), cache, &report, 1)) return false;
+
+	CFrameCost cost;
+	cost.Analyze(actors);
+	scene.warnings = report.GetWarnings();
+	scene.warnings.insert(scene.warnings.end(), cost.GetWarnings().begin(), cost.GetWarnings().end());
+	return true;
+}
+
+string SceneName(const string &path)
+{
+	string name = path.substr(path.find_last_of('/') + 1);
+	string::size_type pos = name.find_last_of('.');
+	if (pos != string::npos && pos > 0) name.erase(pos, string::npos);
+	return name;
+}
+
+// Scenes from different directories can share a file name but each needs an output directory of its own.
+void UniqueSceneNames(vector<BatchScene> &scenes)
+{
+	for (size_t i = 0; i < scenes.size(); i++)
+	{
+		string name = scenes[i].name;
+		auto taken = [&scenes, i] {
+			for (size_t j = 0; j < i; j++)
+			{
+				if (scenes[j].name == scenes[i].name) return true;
+			}
+			return false;
+		};
+		for (int suffix = 2; taken(); suffix++) scenes[i].name = string(name).append("-").append(to_string(suffix));
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned int threadCount = 0;
+	string outputPath("build");
+	vector<BatchScene> scenes;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			threadCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+		{
+			outputPath = argv[++i];
+		}
+		else
+		{
+			BatchScene scene = { argv[i], SceneName(argv[i]), false, 0 };
+			scenes.push_back(scene);
+		}
+	}
+
+	if (scenes.empty())
+	{
+		fprintf(stderr, "usage: %s [-j threads] [-o directory] scene.ultra...\n", argv[0]);
+		return 2;
+	}
+
+	UniqueSceneNames(scenes);
+	mkdir(outputPath.c_str(), 0755);
+
+	CTaskGraph graph;
+	for (auto &scene : scenes)
+	{
+		BatchScene *target = &scene;
+		graph.Add([target, outputPath] {
+			auto start = chrono::steady_clock::now();
+			target->built = BuildScene(*target, outputPath);
+			target->milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+			// A failed scene is reported below and doesn't stop the others.
+			return true;
+		});
+	}
+
+	auto start = chrono::steady_clock::now();
+	graph.Run(threadCount);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	int failed = 0;
+	for (auto &scene : scenes)
+	{
+		printf("%-8s %10.2f ms  %s", scene.built ? "ok" : "failed", scene.milliseconds, scene.path.c_str());
+		if (scene.name != SceneName(scene.path)) printf(" (built into %s)", scene.name.c_str());
+		printf("\n");
+		for (auto &warning : scene.warnings) printf("         warning: %s\n", warning.c_str());
+		if (!scene.built) failed++;
+	}
+
+	printf("%d scenes in %.2f s (%.2f scenes/s), %d failed\n", (int)scenes.size(), seconds,
+		seconds > 0 ? scenes.size() / seconds : 0, failed);
+
+	return failed == 0 ? 0 : 1;
+}
@@ -5,10 +5,16 @@
 
 namespace UltraEd 
 {
+	static_assert(sizeof(Vertex) == vertexFloats * sizeof(float), "Vertex must be tightly packed floats.");
+
+	bool CActor::m_compactGeometry = true;
+
 	CActor::CActor()
 	{
 		ResetId();
-		m_vertexBuffer = 0;
+		m_bufferId = 0;
+		m_bufferPriority = ResourcePriority::Normal;
+		m_vertices = make_shared<vector<Vertex>>();
 		m_position = D3DXVECTOR3(0, 0, 0);
 		m_scale = D3DXVECTOR3(1, 1, 1);
 		m_script = string("void @start()\n{\n\n}\n\nvoid @update()\n{\n\n}\n\nvoid @input(NUContData gamepads[4])\n{\n\n}");
@@ -18,17 +24,34 @@ namespace UltraEd
 
 	void CActor::Release()
 	{
-		if (m_vertexBuffer != NULL)
-		{
-			m_vertexBuffer->Release();
-			m_vertexBuffer = 0;
-		}
+		CVertexBufferPool::Instance().Release(&m_bufferId);
+	}
+
+	void CActor::SetBufferPriority(ResourcePriority::Value priority)
+	{
+		// A buffer already in the pool takes the new priority straight away.
+		m_bufferPriority = priority;
+		CVertexBufferPool::Instance().SetPriority(m_bufferId, priority);
 	}
 
 	void CActor::Import(const char *filePath)
 	{
 		CMesh mesh(filePath);
-		m_vertices = mesh.GetVertices();
+		vector<Vertex> vertices = mesh.GetVertices();
+
+		if (m_compactGeometry && !vertices.empty())
+		{
+			// Keep only the quantized copy around and decode it when needed.
+			m_compactVertices = make_shared<CCompactVertices>();
+			m_compactVertices->Encode(&vertices[0].position.x, vertices.size());
+			m_vertices.reset();
+		}
+		else
+		{
+			m_vertices = make_shared<vector<Vertex>>(vertices);
+			m_compactVertices.reset();
+		}
+
 		if (mesh.GetFileInfo().type == FileType::User)
 		{
 			resources["vertexDataPath"] = mesh.GetFileInfo().path;
@@ -37,30 +60,58 @@ namespace UltraEd
 
 	IDirect3DVertexBuffer8 *CActor::GetBuffer(IDirect3DDevice8 *device)
 	{
-		if (m_vertexBuffer == NULL)
-		{
-			if (FAILED(device->CreateVertexBuffer(
-				m_vertices.size() * sizeof(Vertex),
-				0,
-				D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1,
-				D3DPOOL_DEFAULT,
-				&m_vertexBuffer)))
+		// The pool owns the device buffer so it can be evicted and recreated
+		// without the actor re-uploading its vertices every time.
+		auto vertices = m_vertices;
+		auto compactVertices = m_compactVertices;
+
+		return CVertexBufferPool::Instance().Get(device, &m_bufferId, GetVertexCount(), [vertices, compactVertices](Vertex *target) {
+			if (compactVertices != NULL)
 			{
-				return NULL;
+				for (size_t i = 0; i < compactVertices->GetCount(); i++)
+				{
+					compactVertices->Decode(i, &target[i].position.x);
+				}
 			}
-
-			VOID *pVertices;
-			if (FAILED(m_vertexBuffer->Lock(0, m_vertices.size() * sizeof(Vertex),
-				(BYTE**)&pVertices, 0)))
+			else if (!vertices->empty())
 			{
-				return NULL;
+				memcpy(target, &(*vertices)[0], vertices->size() * sizeof(Vertex));
 			}
+		}, D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1, m_bufferPriority);
+	}
+
+	vector<Vertex> CActor::GetVertices()
+	{
+		if (m_compactVertices == NULL) return *m_vertices;
 
-			memcpy(pVertices, &m_vertices[0], m_vertices.size() * sizeof(Vertex));
-			m_vertexBuffer->Unlock();
+		// Full precision data is only rebuilt for the export.
+		vector<Vertex> vertices(m_compactVertices->GetCount());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			m_compactVertices->Decode(i, &vertices[i].position.x);
 		}
 
-		return m_vertexBuffer;
+		return vertices;
+	}
+
+	size_t CActor::GetVertexCount()
+	{
+		return m_compactVertices != NULL ? m_compactVertices->GetCount() : m_vertices->size();
+	}
+
+	size_t CActor::GetMemoryBytes()
+	{
+		size_t vertexBytes = m_compactVertices != NULL ? m_compactVertices->GetSize() : m_vertices->size() * sizeof(Vertex);
+		return vertexBytes + m_script.size();
+	}
+
+	D3DXVECTOR3 CActor::GetVertexPosition(size_t index)
+	{
+		if (m_compactVertices == NULL) return (*m_vertices)[index].position;
+
+		D3DXVECTOR3 position;
+		m_compactVertices->DecodePosition(index, &position.x);
+		return position;
 	}
 
 	ActorType::Value CActor::GetType(cJSON *item)
@@ -76,6 +127,20 @@ namespace UltraEd
 		D3DXMatrixRotationYawPitchRoll(&m_worldRot, rotation.y, rotation.x, rotation.z);
 	}
 
+	ActorTransform CActor::GetTransform()
+	{
+		ActorTransform transform = { m_position, m_scale };
+		D3DXQuaternionRotationMatrix(&transform.rotation, &m_worldRot);
+		return transform;
+	}
+
+	void CActor::SetTransform(const ActorTransform &transform)
+	{
+		m_position = transform.position;
+		m_scale = transform.scale;
+		D3DXMatrixRotationQuaternion(&m_worldRot, &transform.rotation);
+	}
+
 	D3DXVECTOR3 CActor::GetRight()
 	{
 		D3DXVECTOR3 right = D3DXVECTOR3(1, 0, 0);
@@ -124,18 +189,21 @@ namespace UltraEd
 
 	bool CActor::Pick(D3DXVECTOR3 orig, D3DXVECTOR3 dir, float *dist)
 	{
+		size_t count = GetVertexCount();
+		D3DXMATRIX matrix = GetMatrix();
+
 		// Test all faces in this actor.
-		for (unsigned int j = 0; j < m_vertices.size() / 3; j++)
+		for (size_t j = 0; j < count / 3; j++)
 		{
-			D3DXVECTOR3 v0 = m_vertices[3 * j + 0].position;
-			D3DXVECTOR3 v1 = m_vertices[3 * j + 1].position;
-			D3DXVECTOR3 v2 = m_vertices[3 * j + 2].position;
+			D3DXVECTOR3 v0 = GetVertexPosition(3 * j + 0);
+			D3DXVECTOR3 v1 = GetVertexPosition(3 * j + 1);
+			D3DXVECTOR3 v2 = GetVertexPosition(3 * j + 2);
 
 			// Transform the local vert positions based of the actor's
 			// local matrix so when the actor is moved around we can still click it.
-			D3DXVec3TransformCoord(&v0, &v0, &GetMatrix());
-			D3DXVec3TransformCoord(&v1, &v1, &GetMatrix());
-			D3DXVec3TransformCoord(&v2, &v2, &GetMatrix());
+			D3DXVec3TransformCoord(&v0, &v0, &matrix);
+			D3DXVec3TransformCoord(&v1, &v1, &matrix);
+			D3DXVec3TransformCoord(&v2, &v2, &matrix);
 
 			// Check if the pick ray passes through this point.
 			if (IntersectTriangle(orig, dir, v0, v1, v2, dist))
@@ -1,16 +1,22 @@
 #pragma once
 
+#include <memory>
 #include <vector>
+#include "ActorType.h"
 #include "Vertex.h"
+#include "CompactVertices.h"
+#include "VertexBufferPool.h"
 #include "Savable.h"
 #include "Util.h"
 
 namespace UltraEd
 {
-	struct ActorType
+	typedef struct
 	{
-		enum Value { Model, Camera };
-	};
+		D3DXVECTOR3 position;
+		D3DXVECTOR3 scale;
+		D3DXQUATERNION rotation;
+	} ActorTransform;
 
 	class CActor : public CSavable
 	{
@@ -35,11 +41,17 @@ namespace UltraEd
 		void SetRotation(D3DXVECTOR3 rotation);
 		D3DXVECTOR3 GetScale() { return m_scale; }
 		void SetScale(D3DXVECTOR3 scale) { m_scale = scale; }
+		ActorTransform GetTransform();
+		void SetTransform(const ActorTransform &transform);
 		D3DXVECTOR3 GetRight();
 		D3DXVECTOR3 GetForward();
 		D3DXVECTOR3 GetUp();
 		void GetAxisAngle(D3DXVECTOR3 *axis, float *angle);
-		vector<Vertex> GetVertices() { return m_vertices; }
+		vector<Vertex> GetVertices();
+		size_t GetVertexCount();
+		virtual size_t GetMemoryBytes();
+		static void SetCompactGeometry(bool compact) { m_compactGeometry = compact; }
+		void SetBufferPriority(ResourcePriority::Value priority);
 		bool Pick(D3DXVECTOR3 orig, D3DXVECTOR3 dir, float *dist);
 		string GetScript() { return m_script; }
 		void SetScript(string script) { m_script = script; }
@@ -47,7 +59,7 @@ namespace UltraEd
 		bool Load(IDirect3DDevice8 *device, cJSON *root);
 		
 	protected:
-		IDirect3DVertexBuffer8 *m_vertexBuffer;
+		ResourceId m_bufferId;
 		ActorType::Value m_type;
 		void Import(const char *filePath);
 		IDirect3DVertexBuffer8 *GetBuffer(IDirect3DDevice8 *device);
@@ -55,12 +67,16 @@ namespace UltraEd
 	private:
 		GUID m_id;
 		string m_name;
-		vector<Vertex> m_vertices;
+		static bool m_compactGeometry;
+		shared_ptr<vector<Vertex>> m_vertices;
+		shared_ptr<CCompactVertices> m_compactVertices;
+		ResourcePriority::Value m_bufferPriority;
 		D3DXVECTOR3 m_position;
 		D3DXVECTOR3 m_scale;
 		D3DXMATRIX m_localRot;
 		D3DXMATRIX m_worldRot;
 		string m_script;
+		D3DXVECTOR3 GetVertexPosition(size_t index);
 		bool IntersectTriangle(const D3DXVECTOR3 &orig, const D3DXVECTOR3 &dir,
 			D3DXVECTOR3 &v0, D3DXVECTOR3 &v1, D3DXVECTOR3 &v2, float *dist);
 	};
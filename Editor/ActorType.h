@@ -0,0 +1,9 @@
+#pragma once
+
+namespace UltraEd
+{
+	struct ActorType
+	{
+		enum Value { Model, Camera };
+	};
+}
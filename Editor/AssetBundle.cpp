@@ -0,0 +1,52 @@
+#include <cstdio>
+#include "AssetBundle.h"
+
+namespace UltraEd
+{
+	CAssetBundle::CAssetBundle(unsigned int alignment)
+	{
+		m_alignment = alignment;
+	}
+
+	int CAssetBundle::Add(const string &data)
+	{
+		ContentHash hash = CBuildCache::Hash(data);
+
+		// Reuse an identical asset, comparing bytes in case two hashes collide.
+		auto matches = m_indices.equal_range(hash);
+		for (auto match = matches.first; match != matches.second; ++match)
+		{
+			const AssetEntry &entry = m_entries[match->second];
+			if (m_data.compare(entry.offset, entry.size, data) == 0) return match->second;
+		}
+
+		size_t padding = (m_alignment - m_data.size() % m_alignment) % m_alignment;
+		m_data.append(padding, '\0');
+
+		AssetEntry entry = { (unsigned int)m_data.size(), (unsigned int)data.size() };
+		m_data.append(data);
+		m_entries.push_back(entry);
+
+		int index = (int)m_entries.size() - 1;
+		m_indices.insert(make_pair(hash, index));
+		return index;
+	}
+
+	bool CAssetBundle::AddFile(const string &path, int *index)
+	{
+		FILE *file = fopen(path.c_str(), "rb");
+		if (file == NULL) return false;
+
+		string data;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			data.append(buffer, read);
+		}
+
+		fclose(file);
+		*index = Add(data);
+		return true;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+#include "BuildCache.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		unsigned int offset;
+		unsigned int size;
+	} AssetEntry;
+
+	// Packs build assets into a single blob so the ROM needs one segment no matter
+	// how many actors use them. Identical assets are only stored once and every
+	// asset starts on an aligned offset so it can be read straight into RAM.
+	class CAssetBundle
+	{
+	public:
+		CAssetBundle(unsigned int alignment = 8);
+		int Add(const string &data);
+		bool AddFile(const string &path, int *index);
+		const string &GetData() { return m_data; }
+		const vector<AssetEntry> &GetEntries() { return m_entries; }
+
+	private:
+		unsigned int m_alignment;
+		string m_data;
+		vector<AssetEntry> m_entries;
+		multimap<ContentHash, int> m_indices;
+	};
+}
@@ -4,27 +4,33 @@
 #include <string>
 #include <vector>
 #include "actor.h"
+#include "BuildCore.h"
+#include "BuildQueue.h"
+#include "BuildReport.h"
+#include "FrameCost.h"
 #include "settings.h"
 #include "shlwapi.h"
 
 using namespace std;
 
+// Posted to the editor window whenever build events are waiting.
+#define WM_BUILD_PROGRESS (WM_APP + 1)
+
 namespace UltraEd
 {
+	struct BuildFlag
+	{
+		enum Value { _, Run, Load };
+	};
+
 	class CBuild
 	{
 	public:
-		static bool Start(vector<CActor*> actors);
-		static bool Run();
-		static bool Load();
-		static bool WriteSpecFile(vector<CActor*> actors);
-		static bool WriteSegmentsFile(vector<CActor*> actors);
-		static bool WriteModelsFile(vector<CActor*> actors);
-		static bool WriteCamerasFile(vector<CActor*> actors);
-		static bool WriteScriptsFile(vector<CActor*> actors);
-		static bool WriteMappingsFile(vector<CActor*> actors);
+		static bool Prepare(vector<CActor*> actors, BuildFlag::Value flag, BuildJob *job);
+		static vector<string> EstimateFrameCost(vector<CActor*> actors);
 
 	private:
-		static bool Compile();
+		static vector<BuildActor> GatherActors(vector<CActor*> actors);
+		static BuildBudget LoadBudget();
 	};
 }
@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <vector>
+#include "BuildCache.h"
+
+namespace UltraEd
+{
+	// 64-bit FNV-1a parameters.
+	const ContentHash hashOffset = 14695981039346656037ULL;
+	const ContentHash hashPrime = 1099511628211ULL;
+
+	CBuildCache::CBuildCache(string manifestPath)
+	{
+		m_manifestPath = manifestPath;
+		Load();
+	}
+
+	bool CBuildCache::IsCurrent(const string &output, ContentHash inputs)
+	{
+		{
+			lock_guard<mutex> guard(m_lock);
+			auto entry = m_entries.find(output);
+			if (entry == m_entries.end() || entry->second != inputs) return false;
+		}
+
+		// The output may have been removed since it was last generated.
+		FILE *file = fopen(output.c_str(), "r");
+		if (file == NULL) return false;
+
+		fclose(file);
+		return true;
+	}
+
+	void CBuildCache::Update(const string &output, ContentHash inputs)
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_entries[output] = inputs;
+	}
+
+	void CBuildCache::Load()
+	{
+		FILE *file = fopen(m_manifestPath.c_str(), "r");
+		if (file == NULL) return;
+
+		char line[1024];
+		while (fgets(line, sizeof(line), file) != NULL)
+		{
+			ContentHash hash;
+			char output[1024];
+			if (sscanf(line, "%llx %1023[^\n]", &hash, output) == 2)
+			{
+				m_entries[output] = hash;
+			}
+		}
+
+		fclose(file);
+	}
+
+	bool CBuildCache::Save()
+	{
+		lock_guard<mutex> guard(m_lock);
+		string contents;
+		char line[32];
+		for (auto entry : m_entries)
+		{
+			sprintf(line, "%016llx ", entry.second);
+			contents.append(line).append(entry.first).append("\n");
+		}
+
+		return WriteIfChanged(m_manifestPath, contents);
+	}
+
+	ContentHash CBuildCache::Hash(const void *data, size_t size, ContentHash seed)
+	{
+		const unsigned char *bytes = (const unsigned char*)data;
+		ContentHash hash = seed == 0 ? hashOffset : seed;
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= hashPrime;
+		}
+
+		return hash;
+	}
+
+	ContentHash CBuildCache::Hash(const string &data, ContentHash seed)
+	{
+		// Include the length so neighbouring strings can't run into each other.
+		size_t size = data.size();
+		return Hash(data.data(), data.size(), Hash(&size, sizeof(size), seed));
+	}
+
+	bool CBuildCache::HashFile(const string &path, ContentHash *hash)
+	{
+		FILE *file = fopen(path.c_str(), "rb");
+		if (file == NULL) return false;
+
+		vector<unsigned char> buffer(64 * 1024);
+		ContentHash result = hashOffset;
+		size_t read;
+		while ((read = fread(&buffer[0], 1, buffer.size(), file)) > 0)
+		{
+			result = Hash(&buffer[0], read, result);
+		}
+
+		fclose(file);
+		*hash = result;
+		return true;
+	}
+
+	bool CBuildCache::WriteIfChanged(const string &path, const string &contents, bool binary)
+	{
+		// Leave identical files alone so make keeps their timestamps.
+		FILE *file = fopen(path.c_str(), binary ? "rb" : "r");
+		if (file != NULL)
+		{
+			string existing;
+			char buffer[4096];
+			size_t read;
+			while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			{
+				existing.append(buffer, read);
+			}
+
+			fclose(file);
+			if (existing == contents) return true;
+		}
+
+		file = fopen(path.c_str(), binary ? "wb" : "w");
+		if (file == NULL) return false;
+
+		bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+		fclose(file);
+		return written;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef unsigned long long ContentHash;
+
+	// Remembers the hash of the inputs each generated build file was made from
+	// so unchanged outputs can be skipped and left untouched on disk. It can be
+	// shared by build tasks running on different threads.
+	class CBuildCache
+	{
+	public:
+		CBuildCache(string manifestPath);
+		bool IsCurrent(const string &output, ContentHash inputs);
+		void Update(const string &output, ContentHash inputs);
+		bool Save();
+		static ContentHash Hash(const void *data, size_t size, ContentHash seed = 0);
+		static ContentHash Hash(const string &data, ContentHash seed = 0);
+		static bool HashFile(const string &path, ContentHash *hash);
+		static bool WriteIfChanged(const string &path, const string &contents, bool binary = false);
+
+	private:
+		void Load();
+
+	private:
+		string m_manifestPath;
+		map<string, ContentHash> m_entries;
+		mutex m_lock;
+	};
+}
@@ -0,0 +1,967 @@
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_NO_SIMD
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <regex>
+#include "vendor/stb_image.h"
+#include "vendor/stb_image_resize.h"
+#include "AssetBundle.h"
+#include "BuildCore.h"
+#include "BuildReport.h"
+#include "CompactVertices.h"
+#include "GeometryCodec.h"
+#include "MeshBatcher.h"
+#include "MeshSimplifier.h"
+#include "RomImage.h"
+#include "StaticMerge.h"
+#include "TaskGraph.h"
+#include "TextureAtlas.h"
+
+namespace UltraEd
+{
+	// Bumped whenever the generated texture or mesh formats change.
+	const ContentHash textureVersion = CBuildCache::Hash(string("tmem fitted mip chains"));
+	const ContentHash meshFormat = CBuildCache::Hash(string("compressed geometry streams with 32-bit counts"));
+
+	// Where the engine reads the ROM offset of the asset segment, in a header
+	// word that makerom leaves zeroed.
+	const unsigned int assetBaseOffset = 0x18;
+
+	// Matches struct sos_mesh_header in the engine.
+	const size_t meshHeaderBytes = 52;
+
+	// Meshes with fewer triangles aren't worth simplifying.
+	const int minLodTriangles = 64;
+
+	// The first coarser level takes over once a model's bounding sphere is this many pixels
+	// tall on screen and each level after at half the size. The engine's 80 degree field
+	// of view spans 240 pixels so one unit at a distance of one is 143 pixels.
+	const float lodScreenRadius = 60;
+	const float focalPixels = 143;
+
+	// Size texture coordinates are scaled to when a model has no texture.
+	const int defaultTextureSize = 32;
+
+	// Quantization stops at 1/1024 so the scale stays exact in the RSP's s15.16 matrices.
+	const int maxQuantizationShift = 10;
+	const float maxQuantized = 32767;
+
+	// Every generated source file pulls in the engine's declarations.
+	const char *sourceHeader = "#include \"scene.h\"\n\n";
+
+	bool CBuildCore::Generate(vector<BuildActor> &actors, const string &engineDir, CBuildCache &cache,
+		CBuildReport *report, unsigned int threadCount)
+	{
+		CTaskGraph graph;
+
+		// Static level geometry is baked into shared meshes before anything converts.
+		if (!CStaticMerge::Merge(actors)) return false;
+
+		// Each asset converts on its own thread before they are packed together.
+		map<string, vector<BuildActor*>> textureUsers;
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Model || actor.texturePath.empty()) continue;
+			textureUsers[RomTexturePath(actor.texturePath, actor.textureOptions)].push_back(&actor);
+		}
+
+		// Duplicated models share a texture which must only be converted once for each set of options.
+		map<string, TaskId> textureTasks;
+		for (auto users : textureUsers)
+		{
+			vector<BuildActor*> targets = users.second;
+			textureTasks[users.first] = graph.Add([targets, &cache] {
+				string romPath;
+				if (!ConvertTexture(targets[0]->texturePath, targets[0]->textureOptions, &romPath, cache)) return false;
+				for (auto target : targets)
+				{
+					target->romTexturePath = romPath;
+					if (!ReadTextureSize(romPath, target)) return false;
+				}
+				return true;
+			});
+		}
+
+		// Small textures are packed into shared atlases once all of them are converted.
+		vector<TaskId> textureIds;
+		for (auto task : textureTasks) textureIds.push_back(task.second);
+		TaskId atlases = graph.Add([&actors, engineDir] { return PackAtlases(actors, engineDir); }, textureIds);
+
+		// Texture coordinates are stored in texels so meshes wait for where their texture ended up.
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Model) continue;
+
+			BuildActor *target = &actor;
+			target->textureWidth = target->textureHeight = defaultTextureSize;
+			target->textureOffset[0] = target->textureOffset[1] = 0;
+			target->textureLevels = 1;
+			vector<TaskId> dependencies;
+			if (!target->texturePath.empty()) dependencies.push_back(atlases);
+			graph.Add([target, &cache] { return ConvertMesh(*target, cache); }, dependencies);
+		}
+
+		// Every converted asset is packed into one blob once all of them are ready.
+		auto assets = make_shared<vector<AssetEntry>>();
+		vector<TaskId> conversions(graph.GetCount());
+		for (TaskId i = 0; i < conversions.size(); i++) conversions[i] = i;
+		TaskId pack = graph.Add([&actors, engineDir, assets] {
+			return PackAssets(actors, string(engineDir).append("assets.bin"), assets.get());
+		}, conversions);
+
+		// The report needs the vertex counts and asset sizes the conversions produced.
+		if (report != NULL)
+		{
+			graph.Add([&actors, engineDir, assets, report] {
+				report->Analyze(actors, *assets);
+				return CBuildCache::WriteIfChanged(string(engineDir).append("report.json"), report->ToJson());
+			}, { pack });
+		}
+
+		auto write = [&actors, engineDir](const char *file, string (*generate)(const vector<BuildActor>&)) {
+			return CBuildCache::WriteIfChanged(string(engineDir).append(file), generate(actors));
+		};
+
+		graph.Add([engineDir] { return CBuildCache::WriteIfChanged(string(engineDir).append("spec"), GenerateSpec()); });
+		graph.Add([write] { return write("models.c", GenerateModels); }, { pack });
+		graph.Add([engineDir, assets] {
+			return CBuildCache::WriteIfChanged(string(engineDir).append("assets.c"), GenerateAssets(*assets));
+		}, { pack });
+		graph.Add([write] { return write("cameras.c", GenerateCameras); });
+		graph.Add([write] { return write("scripts.c", GenerateScripts); });
+		graph.Add([write] { return write("mappings.c", GenerateMappings); });
+		graph.Add([write] { return write("actors.mk", GenerateActorList); });
+
+		// Unchanged scripts keep their files untouched so make only rebuilds edited actors.
+		for (int i = 0; i < (int)actors.size(); i++)
+		{
+			const BuildActor *actor = &actors[i];
+			graph.Add([actor, i, engineDir] {
+				string path = string(engineDir).append(ResourceName(i)).append(".c");
+				return CBuildCache::WriteIfChanged(path, GenerateActorScript(*actor, i));
+			});
+		}
+
+		bool generated = graph.Run(threadCount);
+		cache.Save();
+		return generated;
+	}
+
+	bool CBuildCore::ConvertTexture(const string &path, const TextureOptions &options, string *romPath, CBuildCache &cache)
+	{
+		*romPath = RomTexturePath(path, options);
+		ContentHash hash = 0;
+		if (CBuildCache::HashFile(path, &hash))
+		{
+			int values[4] = { options.format, options.dither, options.address, options.mipFilter };
+			hash = CBuildCache::Hash(values, sizeof(values), CBuildCache::Hash(&hash, sizeof(hash), textureVersion));
+		}
+
+		// Only re-encode textures whose source image or options changed.
+		if (hash != 0 && cache.IsCurrent(*romPath, hash)) return true;
+
+		int width, height, channels;
+		unsigned char *data = stbi_load(path.c_str(), &width, &height, &channels, 4);
+		if (data == NULL) return false;
+
+		// Start from the largest power of two size and halve the longer side until the
+		// format the image needs at that size fits TMEM along with its mip levels.
+		int fitWidth, fitHeight;
+		CTextureEncoder::FitSize(width, height, &fitWidth, &fitHeight);
+		vector<unsigned char> resized;
+		TextureOptions fitted = options;
+		while (true)
+		{
+			resized.resize(fitWidth * fitHeight * 4);
+			if (!stbir_resize_uint8(data, width, height, 0, &resized[0], fitWidth, fitHeight, 0, 4))
+			{
+				stbi_image_free(data);
+				return false;
+			}
+
+			fitted.format = CTextureEncoder::ResolveFormat(&resized[0], fitWidth, fitHeight, options.format);
+			int levels = CTextureEncoder::LevelCount(fitted.format, fitWidth, fitHeight, options.mipFilter);
+			if (CTextureEncoder::FitsTmem(fitted.format, fitWidth, fitHeight, levels) || fitWidth * fitHeight == 1) break;
+
+			if (fitWidth >= fitHeight) fitWidth /= 2;
+			else fitHeight /= 2;
+		}
+		stbi_image_free(data);
+
+		// The engine loads the texels as they are so they are written in the RDP's own format.
+		string texture = CTextureEncoder::Encode(&resized[0], fitWidth, fitHeight, fitted);
+		if (!CBuildCache::WriteIfChanged(*romPath, texture, true)) return false;
+		cache.Update(*romPath, hash);
+		return true;
+	}
+
+	string CBuildCore::RomTexturePath(const string &path, const TextureOptions &options)
+	{
+		// The options are baked into the texels so models asking for different ones each get their own file.
+		char suffix[32];
+		sprintf(suffix, ".%d%d%d%d.rom.tex", (int)options.format, (int)options.dither, (int)options.address,
+			(int)options.mipFilter);
+		return string(path).append(suffix);
+	}
+
+	bool CBuildCore::ReadTextureSize(const string &romPath, BuildActor *actor)
+	{
+		FILE *file = fopen(romPath.c_str(), "rb");
+		if (file == NULL) return false;
+
+		unsigned char header[7];
+		bool read = fread(header, 1, sizeof(header), file) == sizeof(header);
+		fclose(file);
+		if (!read) return false;
+
+		actor->textureWidth = header[0] << 8 | header[1];
+		actor->textureHeight = header[2] << 8 | header[3];
+		actor->textureLevels = header[6];
+		return true;
+	}
+
+	bool CBuildCore::PackAtlases(vector<BuildActor> &actors, const string &engineDir)
+	{
+		// Each converted texture is read once and offered for packing when every model
+		// using it keeps its coordinates inside the image, since repeating would show
+		// its neighbours in the atlas.
+		vector<string> paths, textures;
+		vector<vector<BuildActor*>> users;
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Model || actor.texturePath.empty()) continue;
+
+			size_t index = find(paths.begin(), paths.end(), actor.romTexturePath) - paths.begin();
+			if (index == paths.size())
+			{
+				string texture;
+				if (!ReadFile(actor.romTexturePath, &texture)) return false;
+				paths.push_back(actor.romTexturePath);
+				textures.push_back(texture);
+				users.push_back(vector<BuildActor*>());
+			}
+			users[index].push_back(&actor);
+		}
+
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			if (!CTextureAtlas::IsCandidate(textures[i])) continue;
+			for (auto user : users[i])
+			{
+				if (!CoordinatesInside(*user)) textures[i].clear();
+			}
+		}
+
+		vector<TextureAtlas> atlases = CTextureAtlas::Pack(textures);
+		for (size_t i = 0; i < atlases.size(); i++)
+		{
+			char name[32];
+			sprintf(name, "atlas%d.rom.tex", (int)i);
+			string path = string(engineDir).append(name);
+			if (!CBuildCache::WriteIfChanged(path, atlases[i].texture, true)) return false;
+
+			// Models keep scaling their coordinates to their own texture, offset to where it landed.
+			for (size_t member = 0; member < atlases[i].members.size(); member++)
+			{
+				const AtlasRect &region = atlases[i].regions[member];
+				for (auto user : users[atlases[i].members[member]])
+				{
+					user->romTexturePath = path;
+					user->textureWidth = region.width;
+					user->textureHeight = region.height;
+					user->textureOffset[0] = region.x;
+					user->textureOffset[1] = region.y;
+					user->textureLevels = 1;
+				}
+			}
+		}
+		return true;
+	}
+
+	bool CBuildCore::CoordinatesInside(const BuildActor &actor)
+	{
+		// Allow for coordinates exported a little past the edges.
+		const float tolerance = 0.001f;
+		vector<float> vertices;
+		if (!actor.loadVertices || !actor.loadVertices(vertices)) return false;
+
+		for (size_t i = 0; i + vertexFloats <= vertices.size(); i += vertexFloats)
+		{
+			for (int axis = 6; axis < 8; axis++)
+			{
+				if (vertices[i + axis] < -tolerance || vertices[i + axis] > 1 + tolerance) return false;
+			}
+		}
+		return true;
+	}
+
+	bool CBuildCore::MeasureMesh(BuildActor &actor)
+	{
+		vector<float> vertices;
+		if (!actor.loadVertices || !actor.loadVertices(vertices)) return false;
+		MeasureMesh(actor, vertices);
+		return true;
+	}
+
+	void CBuildCore::MeasureMesh(BuildActor &actor, const vector<float> &vertices)
+	{
+		actor.vertexCount = (int)(vertices.size() / vertexFloats);
+
+		// How many vertices the RSP transforms once shared ones are loaded together.
+		vector<int> indices, sources;
+		CMeshBatcher::Weld(vertices, &indices, &sources);
+		vector<MeshBatch> batches = CMeshBatcher::Build(indices, (int)sources.size());
+		actor.loadedVertices = CMeshBatcher::LoadedVertices(batches);
+		actor.batchCount = (int)batches.size();
+		actor.triangleCommands = CMeshBatcher::TriangleCommands(batches);
+
+		for (int axis = 0; axis < 3; axis++)
+		{
+			actor.boundsMin[axis] = actor.boundsMax[axis] = vertices.empty() ? 0 : vertices[axis];
+		}
+
+		for (size_t i = 0; i + vertexFloats <= vertices.size(); i += vertexFloats)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				actor.boundsMin[axis] = min(actor.boundsMin[axis], vertices[i + axis]);
+				actor.boundsMax[axis] = max(actor.boundsMax[axis], vertices[i + axis]);
+			}
+		}
+	}
+
+	bool CBuildCore::ConvertMesh(BuildActor &actor, CBuildCache &cache)
+	{
+		vector<float> vertices;
+		if (!actor.loadVertices || !actor.loadVertices(vertices)) return false;
+		MeasureMesh(actor, vertices);
+
+		// Write out mesh data unless it is unchanged since the last build.
+		int settings[5] = { actor.textureOffset[0], actor.textureOffset[1], actor.textureWidth, actor.textureHeight, actor.lodLevels };
+		ContentHash hash = CBuildCache::Hash(settings, sizeof(settings), meshFormat);
+		if (!vertices.empty()) hash = CBuildCache::Hash(&vertices[0], vertices.size() * sizeof(float), hash);
+
+		// Switch distances follow the model's scale, which the vertices don't carry.
+		vector<float> distances;
+		for (int level = 1; level < actor.lodLevels; level++) distances.push_back(LodDistance(actor, level));
+		if (!distances.empty()) hash = CBuildCache::Hash(&distances[0], distances.size() * sizeof(float), hash);
+
+		string mesh;
+		if (cache.IsCurrent(actor.meshPath, hash) && ReadFile(actor.meshPath, &mesh)) return ReadLevels(mesh, actor);
+
+		// Coarser levels aim for half the triangles of the one before and stop once the
+		// simplifier can't take away at least a quarter of them.
+		vector<vector<float>> levels(1, vertices);
+		int triangles = actor.vertexCount / 3;
+		for (int level = 1; level < actor.lodLevels && triangles >= minLodTriangles; level++)
+		{
+			vector<float> simplified = CMeshSimplifier::Simplify(vertices, triangles >> level);
+			if (simplified.size() * 4 > levels.back().size() * 3) break;
+			levels.push_back(simplified);
+		}
+
+		for (size_t level = 0; level < levels.size(); level++)
+		{
+			mesh.append(EncodeMesh(actor, levels[level], LodDistance(actor, (int)level), (int)levels.size()));
+		}
+		if (!ReadLevels(mesh, actor)) return false;
+
+		FILE *file = fopen(actor.meshPath.c_str(), "wb");
+		if (file == NULL) return false;
+		bool written = fwrite(mesh.data(), 1, mesh.size(), file) == mesh.size();
+		fclose(file);
+		if (written) cache.Update(actor.meshPath, hash);
+		return written;
+	}
+
+	float CBuildCore::LodDistance(const BuildActor &actor, int level)
+	{
+		if (level == 0) return 0;
+
+		float diagonal = 0, scale = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = actor.boundsMax[axis] - actor.boundsMin[axis];
+			diagonal += extent * extent;
+			scale = max(scale, fabs(actor.scale[axis]));
+		}
+		float radius = sqrt(diagonal) / 2 * scale;
+		return radius * focalPixels / ldexp(lodScreenRadius, 1 - level);
+	}
+
+	bool CBuildCore::ReadLevels(const string &mesh, BuildActor &actor)
+	{
+		// Each level is a whole mesh of its own, one after the other.
+		actor.lods.clear();
+		size_t start = 0;
+		while (start + meshHeaderBytes <= mesh.size())
+		{
+			const unsigned char *header = (const unsigned char*)&mesh[start];
+			MeshLevel level;
+			level.loadedVertices = header[0] << 24 | header[1] << 16 | header[2] << 8 | header[3];
+			level.batchCount = header[32] << 24 | header[33] << 16 | header[34] << 8 | header[35];
+			level.triangles = header[36] << 24 | header[37] << 16 | header[38] << 8 | header[39];
+			unsigned int bits = (unsigned int)header[40] << 24 | header[41] << 16 | header[42] << 8 | header[43];
+			memcpy(&level.distance, &bits, sizeof(bits));
+			size_t streamBytes = (size_t)header[48] << 24 | header[49] << 16 | header[50] << 8 | header[51];
+
+			// The batch table comes out of the stream along with the vertices.
+			size_t stream = start + meshHeaderBytes;
+			if (stream + streamBytes > mesh.size()) return false;
+			vector<short> vertices;
+			vector<unsigned char> table;
+			if (!CGeometryCodec::Decode(mesh.substr(stream, streamBytes), level.batchCount, &vertices, &table)) return false;
+
+			level.triangleCommands = 0;
+			for (int batch = 0; batch < level.batchCount; batch++) level.triangleCommands += (table[batch * 2 + 1] + 1) / 2;
+			actor.lods.push_back(level);
+			start = stream + streamBytes + streamBytes % 2;
+		}
+		return start == mesh.size() && !actor.lods.empty();
+	}
+
+	MeshLevel CBuildCore::LevelAt(const BuildActor &actor, float distance)
+	{
+		MeshLevel full = { 0, actor.vertexCount / 3, actor.loadedVertices, actor.batchCount, actor.triangleCommands };
+		MeshLevel level = actor.lods.empty() ? full : actor.lods[0];
+		for (auto &lod : actor.lods)
+		{
+			if (distance >= lod.distance) level = lod;
+		}
+		return level;
+	}
+
+	string CBuildCore::EncodeMesh(const BuildActor &actor, const vector<float> &vertices, float lodDistance, int lodCount)
+	{
+		// Pick the finest power of two step that still fits the largest coordinate.
+		float extent = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			extent = max(extent, max(fabs(actor.boundsMin[axis]), fabs(actor.boundsMax[axis])));
+		}
+
+		int shift = maxQuantizationShift;
+		while (extent * ldexp(1.0f, shift) > maxQuantized) shift--;
+		float quantize = ldexp(1.0f, shift);
+		float scale = ldexp(1.0f, -shift);
+
+		// Shared vertices are welded and the triangles grouped into loads of the vertex buffer.
+		vector<int> indices, sources;
+		CMeshBatcher::Weld(vertices, &indices, &sources);
+		vector<MeshBatch> batches = CMeshBatcher::Build(indices, (int)sources.size());
+		int triangles = 0;
+		for (auto &batch : batches) triangles += (int)batch.triangles.size() / 3;
+
+		// Every batch's vertices in the order they are loaded, compressed along with the triangles.
+		// The engine's z axis points the other way.
+		vector<short> quantized;
+		for (auto &batch : batches)
+		{
+			for (auto vertex : batch.vertices)
+			{
+				const float *vert = &vertices[sources[vertex] * vertexFloats];
+				quantized.push_back((short)floor(vert[0] * quantize + 0.5f));
+				quantized.push_back((short)floor(vert[1] * quantize + 0.5f));
+				quantized.push_back((short)floor(-vert[2] * quantize + 0.5f));
+				quantized.push_back((short)TexelCoordinate(vert[6], actor.textureOffset[0], actor.textureWidth));
+				quantized.push_back((short)TexelCoordinate(vert[7], actor.textureOffset[1], actor.textureHeight));
+			}
+		}
+		string stream = CGeometryCodec::Encode(batches, quantized);
+
+		string mesh;
+		AppendWord(mesh, CMeshBatcher::LoadedVertices(batches));
+		AppendFloat(mesh, scale);
+		float bounds[6] = { actor.boundsMin[0], actor.boundsMin[1], -actor.boundsMax[2],
+			actor.boundsMax[0], actor.boundsMax[1], -actor.boundsMin[2] };
+		for (auto bound : bounds) AppendFloat(mesh, bound);
+		AppendWord(mesh, (unsigned int)batches.size());
+		AppendWord(mesh, (unsigned int)triangles);
+		AppendFloat(mesh, lodDistance);
+		AppendHalf(mesh, (unsigned short)lodCount);
+		AppendHalf(mesh, 0);
+		AppendWord(mesh, (unsigned int)stream.size());
+		mesh.append(stream);
+
+		// PI DMA moves an even number of bytes.
+		if (mesh.size() % 2 != 0) mesh.push_back('\0');
+		return mesh;
+	}
+
+	string CBuildCore::GenerateSpec()
+	{
+		const char *specHeader = "#include <nusys.h>\n\n"
+			"beginseg"
+			"\n\tname \"code\""
+			"\n\tflags BOOT OBJECT"
+			"\n\tentry nuBoot"
+			"\n\taddress NU_SPEC_BOOT_ADDR"
+			"\n\tstack NU_SPEC_BOOT_STACK"
+			"\n\tinclude \"codesegment.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\rspboot.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\aspMain.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspF3DEX2.fifo.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspL3DEX2.fifo.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspF3DEX2.Rej.fifo.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspF3DEX2.NoN.fifo.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspF3DLX2.Rej.fifo.o\""
+			"\n\tinclude \"$(ROOT)\\usr\\lib\\PR\\gspS2DEX2.fifo.o\""
+			"\nendseg\n";
+		const char *specIncludeStart = "\nbeginwave"
+			"\n\tname \"main\""
+			"\n\tinclude \"code\"";
+		const char *specIncludeEnd = "\nendwave";
+
+		// Only the code goes through makerom. Assets are laid out after it by Package.
+		string spec = regex_replace(string(specHeader), regex("\\\\"), "\\\\");
+		spec.append(specIncludeStart).append(specIncludeEnd);
+		return spec;
+	}
+
+	string CBuildCore::GenerateAssets(const vector<AssetEntry> &assets)
+	{
+		char buffer[64];
+		string table(sourceHeader);
+
+		if (assets.empty())
+		{
+			table.append("struct asset _UER_Assets[1];\n");
+			return table;
+		}
+
+		table.append("struct asset _UER_Assets[] = {");
+		for (auto &asset : assets)
+		{
+			sprintf(buffer, "\n\t{ %u, %u },", asset.offset, asset.size);
+			table.append(buffer);
+		}
+		return table.append("\n};\n");
+	}
+
+	string CBuildCore::GenerateModels(const vector<BuildActor> &actors)
+	{
+		string modelLoadStart("\nvoid _UER_Load() {");
+		const char *modelLoadEnd = "}";
+		const char *drawStart = "\n\nvoid _UER_Draw(Gfx **display_list) {";
+		const char *drawEnd = "}";
+		string modelInits, modelDraws;
+		int loopCount = 0;
+		char countBuffer[16];
+		vector<int> modelIndices(actors.size(), -1);
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			const BuildActor &actor = actors[i];
+			if (actor.type != ActorType::Model) continue;
+
+			modelIndices[i] = loopCount;
+			sprintf(countBuffer, "%d", loopCount++);
+			modelInits.append("\n\t_UER_Models[");
+			modelInits.append(countBuffer);
+
+			char assetBuffer[64];
+			sprintf(assetBuffer, "ASSET_START(%d), ASSET_END(%d)", actor.meshAsset, actor.meshAsset);
+			if (!actor.texturePath.empty())
+			{
+				modelInits.append("] = (struct sos_model*)load_sos_model_with_texture(");
+				modelInits.append(assetBuffer);
+				sprintf(assetBuffer, ", ASSET_START(%d), ASSET_END(%d)", actor.textureAsset, actor.textureAsset);
+				modelInits.append(assetBuffer);
+			}
+			else {
+				modelInits.append("] = (struct sos_model*)load_sos_model(");
+				modelInits.append(assetBuffer);
+			}
+
+			// Add transform data.
+			char vectorBuffer[128];
+			sprintf(vectorBuffer, ", %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf, %lf",
+				actor.position[0], actor.position[1], actor.position[2],
+				actor.axis[0], actor.axis[1], actor.axis[2], actor.angle,
+				actor.scale[0], actor.scale[1], actor.scale[2]);
+			modelInits.append(vectorBuffer);
+			modelInits.append(");\n");
+		}
+
+		for (auto index : DrawOrder(actors))
+		{
+			sprintf(countBuffer, "%d", modelIndices[index]);
+			modelDraws.append("\n\tsos_draw(_UER_Models[");
+			modelDraws.append(countBuffer);
+			modelDraws.append("], display_list);\n");
+		}
+
+		sprintf(countBuffer, "%d", loopCount);
+		string modelArray(sourceHeader);
+		modelArray.append("struct sos_model *_UER_Models[");
+		modelArray.append(countBuffer);
+		modelArray.append("];\n");
+		modelLoadStart.insert(0, modelArray);
+
+		modelLoadStart.append(modelInits).append(modelLoadEnd);
+		modelLoadStart.append(drawStart).append(modelDraws).append(drawEnd);
+		return modelLoadStart;
+	}
+
+	string CBuildCore::GenerateCameras(const vector<BuildActor> &actors)
+	{
+		string cameraSetStart("void _UER_Camera() {");
+		const char *cameraSetEnd = "}";
+		string cameras;
+		int cameraCount = 0;
+		char countBuffer[16];
+
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Camera) continue;
+
+			sprintf(countBuffer, "%d", cameraCount++);
+			cameras.append("\n\t_UER_Cameras[").append(countBuffer).append("] = (struct sos_model*)create_camera(");
+
+			char vectorBuffer[128];
+			sprintf(vectorBuffer, "%lf, %lf, %lf, %lf, %lf, %lf, %lf",
+				actor.position[0], actor.position[1], actor.position[2],
+				actor.axis[0], actor.axis[1], actor.axis[2], actor.angle);
+			cameras.append(vectorBuffer);
+			cameras.append(");\n");
+		}
+
+		sprintf(countBuffer, "%d", cameraCount);
+		string cameraArray(sourceHeader);
+		cameraArray.append("struct sos_model *_UER_Cameras[");
+		cameraArray.append(countBuffer);
+		cameraArray.append("];\n");
+		cameraSetStart.insert(0, cameraArray);
+
+		cameraSetStart.append(cameras).append(cameraSetEnd);
+		return cameraSetStart;
+	}
+
+	string CBuildCore::GenerateScripts(const vector<BuildActor> &actors)
+	{
+		string prototypes;
+
+		string scriptStartStart("void _UER_Start() {");
+		const char *scriptStartEnd = "}";
+
+		string scriptUpdateStart("\n\nvoid _UER_Update() {");
+		const char *scriptUpdateEnd = "}";
+
+		string inputStart("\n\nvoid _UER_Input(NUContData gamepads[4]) {");
+		const char *inputEnd = "}";
+
+		// Only the hooks live here, each actor's script is compiled on its own.
+		for (int i = 0; i < (int)actors.size(); i++)
+		{
+			string newResName = ResourceName(i);
+			int hooks = RewriteScript(actors[i], i, NULL);
+
+			if (hooks & ScriptHook::Start)
+			{
+				prototypes.append("void ").append(newResName).append("start();\n");
+				scriptStartStart.append("\n\t").append(newResName).append("start();\n");
+			}
+			if (hooks & ScriptHook::Update)
+			{
+				prototypes.append("void ").append(newResName).append("update();\n");
+				scriptUpdateStart.append("\n\t").append(newResName).append("update();\n");
+			}
+			if (hooks & ScriptHook::Input)
+			{
+				prototypes.append("void ").append(newResName).append("input(NUContData gamepads[4]);\n");
+				inputStart.append("\n\t").append(newResName).append("input(gamepads);\n");
+			}
+		}
+
+		string scripts(sourceHeader);
+		scripts.append(prototypes).append("\n");
+		scripts.append(scriptStartStart).append(scriptStartEnd);
+		scripts.append(scriptUpdateStart).append(scriptUpdateEnd);
+		scripts.append(inputStart).append(inputEnd);
+		return scripts;
+	}
+
+	string CBuildCore::GenerateActorScript(const BuildActor &actor, int index)
+	{
+		string script(sourceHeader);
+		RewriteScript(actor, index, &script);
+		return script.append("\n");
+	}
+
+	string CBuildCore::GenerateActorList(const vector<BuildActor> &actors)
+	{
+		string list("ACTORFILES =");
+		for (int i = 0; i < (int)actors.size(); i++)
+		{
+			list.append(" ").append(ResourceName(i)).append(".c");
+		}
+		return list.append("\n");
+	}
+
+	string CBuildCore::GenerateMappings(const vector<BuildActor> &actors)
+	{
+		string mappingsStart(sourceHeader);
+		mappingsStart.append("void _UER_Mappings() {");
+		const char *mappingsEnd = "\n}";
+
+		int loopCount = 0;
+		char countBuffer[16];
+
+		for (auto &actor : actors)
+		{
+			sprintf(countBuffer, "%d", loopCount++);
+			mappingsStart.append("\n\tinsert(\"").append(actor.name).append("\", ").append(countBuffer).append(");");
+		}
+
+		mappingsStart.append(mappingsEnd);
+		return mappingsStart;
+	}
+
+	bool CBuildCore::PackAssets(vector<BuildActor> &actors, const string &path, vector<AssetEntry> *assets)
+	{
+		CAssetBundle bundle;
+		map<string, int> packed;
+
+		// Files shared by several actors are only read once.
+		auto add = [&bundle, &packed](const string &file, int *index) {
+			auto existing = packed.find(file);
+			if (existing != packed.end())
+			{
+				*index = existing->second;
+				return true;
+			}
+
+			if (!bundle.AddFile(file, index)) return false;
+			packed[file] = *index;
+			return true;
+		};
+
+		// Textures are read up front so palettes can be shared between all of them.
+		vector<string> texturePaths, textures;
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Model || actor.texturePath.empty()) continue;
+			if (find(texturePaths.begin(), texturePaths.end(), actor.romTexturePath) != texturePaths.end()) continue;
+
+			string texture;
+			if (!ReadFile(actor.romTexturePath, &texture)) return false;
+			texturePaths.push_back(actor.romTexturePath);
+			textures.push_back(texture);
+		}
+		CTextureEncoder::SharePalettes(textures);
+
+		for (auto &actor : actors)
+		{
+			if (actor.type != ActorType::Model) continue;
+
+			if (!add(actor.meshPath, &actor.meshAsset)) return false;
+
+			actor.paletteEntries = 0;
+			if (actor.texturePath.empty()) continue;
+
+			size_t textureIndex = find(texturePaths.begin(), texturePaths.end(), actor.romTexturePath) - texturePaths.begin();
+			string texture = textures[textureIndex];
+			actor.paletteEntries = CTextureEncoder::PaletteEntries(texture);
+
+			// Palettes are stored apart from the texels so textures sharing one only
+			// store it once and the header tells the engine which asset holds it.
+			if (actor.paletteEntries > 0)
+			{
+				size_t paletteBytes = actor.paletteEntries * 2;
+				if (texture.size() < paletteBytes) return false;
+				actor.paletteAsset = bundle.Add(texture.substr(texture.size() - paletteBytes));
+				texture.resize(texture.size() - paletteBytes);
+				texture[10] = (char)(actor.paletteAsset >> 8);
+				texture[11] = (char)actor.paletteAsset;
+			}
+			actor.textureAsset = bundle.Add(texture);
+		}
+
+		*assets = bundle.GetEntries();
+		return CBuildCache::WriteIfChanged(path, bundle.GetData(), true);
+	}
+
+	bool CBuildCore::Package(const string &engineDir)
+	{
+		string code, assets;
+		if (!ReadFile(string(engineDir).append("code.n64"), &code)) return false;
+		if (!ReadFile(string(engineDir).append("assets.bin"), &assets)) return false;
+
+		CRomImage rom(code);
+		rom.SetWord(assetBaseOffset, rom.AddSegment("assets", assets));
+		if (!rom.Finalize()) return false;
+
+		return CBuildCache::WriteIfChanged(string(engineDir).append("main.n64"), rom.GetData(), true);
+	}
+
+	vector<size_t> CBuildCore::DrawOrder(const vector<BuildActor> &actors)
+	{
+		vector<size_t> order;
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			if (actors[i].type == ActorType::Model) order.push_back(i);
+		}
+
+		// Models sharing a texture or atlas are drawn together so its state is set once.
+		stable_sort(order.begin(), order.end(), [&actors](size_t a, size_t b) {
+			return TextureKey(actors[a]) < TextureKey(actors[b]);
+		});
+		return order;
+	}
+
+	string CBuildCore::TextureKey(const BuildActor &actor)
+	{
+		// Converted textures are known once built, otherwise the source stands in for them.
+		return actor.romTexturePath.empty() ? actor.texturePath : actor.romTexturePath;
+	}
+
+	void CBuildCore::Rotate(const float axis[3], float degrees, float point[3])
+	{
+		float length = sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		if (length == 0 || degrees == 0) return;
+
+		float k[3] = { axis[0] / length, axis[1] / length, axis[2] / length };
+		float radians = degrees * 3.14159265f / 180;
+		float c = cos(radians), s = sin(radians);
+		float dot = k[0] * point[0] + k[1] * point[1] + k[2] * point[2];
+		float cross[3] = {
+			k[1] * point[2] - k[2] * point[1],
+			k[2] * point[0] - k[0] * point[2],
+			k[0] * point[1] - k[1] * point[0]
+		};
+
+		// Rodrigues' rotation which matches D3DXMatrixRotationAxis.
+		for (int i = 0; i < 3; i++)
+		{
+			point[i] = point[i] * c + cross[i] * s + k[i] * dot * (1 - c);
+		}
+	}
+
+	bool CBuildCore::ReadFile(const string &path, string *data)
+	{
+		FILE *file = fopen(path.c_str(), "rb");
+		if (file == NULL) return false;
+
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		{
+			data->append(buffer, read);
+		}
+
+		fclose(file);
+		return true;
+	}
+
+	unsigned short CBuildCore::TexelCoordinate(float uv, int offset, int size)
+	{
+		// S10.5 texels, saturated since large textures cover fewer repeats.
+		float texel = floor((offset + uv * size) * 32 + 0.5f);
+		return (unsigned short)(short)min(32767.0f, max(-32768.0f, texel));
+	}
+
+	void CBuildCore::AppendHalf(string &data, unsigned short value)
+	{
+		data.push_back((char)(value >> 8));
+		data.push_back((char)value);
+	}
+
+	void CBuildCore::AppendWord(string &data, unsigned int value)
+	{
+		AppendHalf(data, (unsigned short)(value >> 16));
+		AppendHalf(data, (unsigned short)value);
+	}
+
+	void CBuildCore::AppendFloat(string &data, float value)
+	{
+		unsigned int bits;
+		memcpy(&bits, &value, sizeof(bits));
+		AppendWord(data, bits);
+	}
+
+	string CBuildCore::ResourceName(int count)
+	{
+		char buffer[16];
+		sprintf(buffer, "UER_%d", count);
+		return string(buffer);
+	}
+
+	int CBuildCore::RewriteScript(const BuildActor &actor, int index, string *output)
+	{
+		const string &script = actor.script;
+		const size_t length = script.size();
+		string newResName = ResourceName(index);
+		int hooks = 0;
+
+		char actorRef[32];
+		sprintf(actorRef, "%s[%d]->", actor.type == ActorType::Model ? "_UER_Models" : "_UER_Cameras", index);
+
+		if (output != NULL) output->reserve(output->size() + length + length / 4);
+
+		// Walk the script once token by token so comments and literals are left
+		// alone and only whole self-> references are rewritten.
+		size_t i = 0;
+		while (i < length)
+		{
+			char c = script[i];
+			size_t next = i + 1;
+
+			if (c == '/' && next < length && (script[next] == '/' || script[next] == '*'))
+			{
+				bool line = script[next] == '/';
+				next = script.find(line ? "\n" : "*/", i + 2);
+				next = next == string::npos ? length : next + (line ? 0 : 2);
+			}
+			else if (c == '"' || c == '\'')
+			{
+				while (next < length && script[next] != c) next += script[next] == '\\' ? 2 : 1;
+				next = min(next + 1, length);
+			}
+			else if (c == '@')
+			{
+				// The name after @ is copied as is on the next token.
+				size_t nameEnd = IdentifierEnd(script, next);
+				size_t call = nameEnd;
+				while (call < length && (script[call] == ' ' || script[call] == '\t')) call++;
+
+				if (call < length && script[call] == '(')
+				{
+					string name = script.substr(next, nameEnd - next);
+					if (name == "start") hooks |= ScriptHook::Start;
+					else if (name == "update") hooks |= ScriptHook::Update;
+					else if (name == "input") hooks |= ScriptHook::Input;
+				}
+
+				if (output != NULL) output->append(newResName);
+				i = next;
+				continue;
+			}
+			else if (isalnum((unsigned char)c) || c == '_')
+			{
+				next = IdentifierEnd(script, i);
+				if (next - i == 4 && script.compare(i, 4, "self") == 0 && script.compare(next, 2, "->") == 0)
+				{
+					if (output != NULL) output->append(actorRef);
+					i = next + 2;
+					continue;
+				}
+			}
+
+			if (output != NULL) output->append(script, i, next - i);
+			i = next;
+		}
+
+		return hooks;
+	}
+
+	size_t CBuildCore::IdentifierEnd(const string &text, size_t start)
+	{
+		while (start < text.size() && (isalnum((unsigned char)text[start]) || text[start] == '_')) start++;
+		return start;
+	}
+}
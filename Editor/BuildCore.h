@@ -0,0 +1,111 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "ActorType.h"
+#include "AssetBundle.h"
+#include "BuildCache.h"
+#include "TextureEncoder.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		float distance; // From the camera, where the engine starts drawing this level.
+		int triangles;
+		int loadedVertices;
+		int batchCount;
+		int triangleCommands;
+	} MeshLevel;
+
+	// Everything the build needs to know about an actor, without depending on
+	// the editor, a window or a device.
+	typedef struct
+	{
+		ActorType::Value type;
+		string name;
+		string script;
+		float position[3];
+		float axis[3];
+		float angle; // In degrees.
+		float scale[3];
+		bool isStatic; // Never moves so it can be merged into the level geometry around it.
+		string meshPath;
+		string texturePath;
+		string romTexturePath;
+		TextureOptions textureOptions;
+		int textureWidth;
+		int textureHeight;
+		int textureOffset[2]; // Where the texture starts inside the atlas it was packed into.
+		int textureLevels;
+		int meshAsset;
+		int textureAsset;
+		int paletteAsset;
+		int paletteEntries;
+		int vertexCount; // Three for each triangle.
+		int loadedVertices;
+		int batchCount;
+		int triangleCommands;
+		int lodLevels; // Most detail levels to generate, counting the full mesh.
+		vector<MeshLevel> lods; // Every level the mesh asset holds, finest first.
+		float boundsMin[3];
+		float boundsMax[3];
+		function<bool(vector<float> &vertices)> loadVertices;
+	} BuildActor;
+
+	struct ScriptHook
+	{
+		enum Value { Start = 1, Update = 2, Input = 4 };
+	};
+
+	class CBuildReport;
+
+	// Generates the engine sources and converts the assets of a scene. Shared
+	// by the editor and the headless batch driver.
+	class CBuildCore
+	{
+	public:
+		static bool Generate(vector<BuildActor> &actors, const string &engineDir, CBuildCache &cache,
+			CBuildReport *report = NULL, unsigned int threadCount = 0);
+		static string GenerateSpec();
+		static string GenerateAssets(const vector<AssetEntry> &assets);
+		static string GenerateModels(const vector<BuildActor> &actors);
+		static string GenerateCameras(const vector<BuildActor> &actors);
+		static string GenerateScripts(const vector<BuildActor> &actors);
+		static string GenerateActorScript(const BuildActor &actor, int index);
+		static string GenerateActorList(const vector<BuildActor> &actors);
+		static string GenerateMappings(const vector<BuildActor> &actors);
+		static string ResourceName(int count);
+		static bool MeasureMesh(BuildActor &actor);
+		static string EncodeMesh(const BuildActor &actor, const vector<float> &vertices,
+			float lodDistance = 0, int lodCount = 1);
+		static MeshLevel LevelAt(const BuildActor &actor, float distance);
+		static bool Package(const string &engineDir);
+		static vector<size_t> DrawOrder(const vector<BuildActor> &actors);
+		static string TextureKey(const BuildActor &actor);
+		static void Rotate(const float axis[3], float degrees, float point[3]);
+
+	private:
+		CBuildCore() {}
+		static bool ConvertTexture(const string &path, const TextureOptions &options, string *romPath, CBuildCache &cache);
+		static string RomTexturePath(const string &path, const TextureOptions &options);
+		static bool ReadTextureSize(const string &romPath, BuildActor *actor);
+		static bool PackAtlases(vector<BuildActor> &actors, const string &engineDir);
+		static bool CoordinatesInside(const BuildActor &actor);
+		static bool ConvertMesh(BuildActor &actor, CBuildCache &cache);
+		static void MeasureMesh(BuildActor &actor, const vector<float> &vertices);
+		static float LodDistance(const BuildActor &actor, int level);
+		static bool ReadLevels(const string &mesh, BuildActor &actor);
+		static bool PackAssets(vector<BuildActor> &actors, const string &path, vector<AssetEntry> *assets);
+		static bool ReadFile(const string &path, string *data);
+		static int RewriteScript(const BuildActor &actor, int index, string *output);
+		static size_t IdentifierEnd(const string &text, size_t start);
+		static unsigned short TexelCoordinate(float uv, int offset, int size);
+		static void AppendHalf(string &data, unsigned short value);
+		static void AppendWord(string &data, unsigned int value);
+		static void AppendFloat(string &data, float value);
+	};
+}
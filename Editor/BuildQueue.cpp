@@ -0,0 +1,147 @@
+#include "BuildQueue.h"
+
+namespace UltraEd
+{
+	CBuildQueue::CBuildQueue()
+	{
+		m_stopping = false;
+		m_building = false;
+		m_pending = false;
+	}
+
+	CBuildQueue::~CBuildQueue()
+	{
+		{
+			lock_guard<mutex> guard(m_lock);
+			m_stopping = true;
+			m_pending = false;
+			m_process.Cancel();
+		}
+
+		m_wake.notify_all();
+		if (m_worker.joinable()) m_worker.join();
+	}
+
+	void CBuildQueue::Submit(const BuildJob &job)
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_next = job;
+		m_pending = true;
+
+		// The worker only starts once the first build is requested.
+		if (!m_worker.joinable()) m_worker = thread(&CBuildQueue::Work, this);
+		m_wake.notify_all();
+	}
+
+	void CBuildQueue::Cancel()
+	{
+		// Kill under the lock so a cancel can't land on the next job instead.
+		lock_guard<mutex> guard(m_lock);
+		m_pending = false;
+		if (m_building) m_process.Cancel();
+	}
+
+	bool CBuildQueue::IsBusy()
+	{
+		lock_guard<mutex> guard(m_lock);
+		return m_building || m_pending;
+	}
+
+	bool CBuildQueue::Poll(BuildEvent *event)
+	{
+		lock_guard<mutex> guard(m_lock);
+		if (m_events.empty()) return false;
+
+		*event = m_events.front();
+		m_events.pop_front();
+		return true;
+	}
+
+	void CBuildQueue::SetNotify(function<void()> notify)
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_notify = notify;
+	}
+
+	void CBuildQueue::Work()
+	{
+		while (true)
+		{
+			BuildJob job;
+			{
+				unique_lock<mutex> guard(m_lock);
+				m_wake.wait(guard, [this] { return m_pending || m_stopping; });
+				if (m_stopping) return;
+
+				job = m_next;
+				m_next = BuildJob();
+				m_pending = false;
+				m_building = true;
+				m_process.Reset();
+			}
+
+			string message;
+			BuildResult::Value result = Execute(job, &message);
+
+			// Stay busy until the result is posted so it can't be missed by a listener.
+			Post(BuildEventType::Finished, message, 0, (int)job.stages.size(), result);
+
+			lock_guard<mutex> guard(m_lock);
+			m_building = false;
+		}
+	}
+
+	BuildResult::Value CBuildQueue::Execute(const BuildJob &job, string *message)
+	{
+		int stageCount = (int)job.stages.size();
+		for (int i = 0; i < stageCount; i++)
+		{
+			const BuildStage &stage = job.stages[i];
+			if (m_process.IsCancelled()) return BuildResult::Cancelled;
+
+			Post(BuildEventType::Stage, stage.name, i + 1, stageCount);
+
+			auto output = [this, i, stageCount](const string &line) {
+				Post(BuildEventType::Output, line, i + 1, stageCount);
+			};
+
+			bool succeeded = true;
+			if (stage.work)
+			{
+				succeeded = stage.work(output);
+			}
+
+			if (succeeded && !stage.command.empty())
+			{
+				succeeded = m_process.Run(stage.command, stage.directory, output) == 0;
+			}
+
+			if (m_process.IsCancelled()) return BuildResult::Cancelled;
+
+			if (!succeeded)
+			{
+				*message = stage.failure;
+				return BuildResult::Failed;
+			}
+		}
+
+		*message = job.success;
+		return BuildResult::Succeeded;
+	}
+
+	void CBuildQueue::Post(BuildEventType::Value type, const string &text, int stage, int stageCount,
+		BuildResult::Value result)
+	{
+		function<void()> notify;
+		{
+			lock_guard<mutex> guard(m_lock);
+			BuildEvent event = { type, text, stage, stageCount, result };
+			m_events.push_back(event);
+
+			// Only wake the listener when it has drained everything it was told about.
+			if (m_events.size() == 1) notify = m_notify;
+		}
+
+		if (notify) notify();
+	}
+}
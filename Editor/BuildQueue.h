@@ -0,0 +1,84 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Process.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	struct BuildEventType
+	{
+		enum Value { Stage, Output, Finished };
+	};
+
+	struct BuildResult
+	{
+		enum Value { Succeeded, Failed, Cancelled };
+	};
+
+	// A step of a build which either runs work in process or a shell command.
+	typedef struct
+	{
+		string name;
+		function<bool(function<void(const string &line)> output)> work;
+		string command;
+		string directory;
+		string failure;
+	} BuildStage;
+
+	// Everything a build needs is captured when it is submitted so the scene can
+	// keep changing while it runs.
+	typedef struct
+	{
+		vector<BuildStage> stages;
+		string success;
+	} BuildJob;
+
+	typedef struct
+	{
+		BuildEventType::Value type;
+		string text;
+		int stage;
+		int stageCount;
+		BuildResult::Value result;
+	} BuildEvent;
+
+	// Runs build jobs one at a time on a background thread. Submitting while a build
+	// is in flight replaces any job still waiting so only the latest request runs next.
+	class CBuildQueue
+	{
+	public:
+		CBuildQueue();
+		~CBuildQueue();
+		void Submit(const BuildJob &job);
+		void Cancel();
+		bool IsBusy();
+		bool Poll(BuildEvent *event);
+		void SetNotify(function<void()> notify);
+
+	private:
+		void Work();
+		BuildResult::Value Execute(const BuildJob &job, string *message);
+		void Post(BuildEventType::Value type, const string &text, int stage = 0, int stageCount = 0,
+			BuildResult::Value result = BuildResult::Succeeded);
+
+	private:
+		mutex m_lock;
+		condition_variable m_wake;
+		thread m_worker;
+		bool m_stopping;
+		bool m_building;
+		bool m_pending;
+		BuildJob m_next;
+		CProcess m_process;
+		deque<BuildEvent> m_events;
+		function<void()> m_notify;
+	};
+}
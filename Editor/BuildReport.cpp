@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include "vendor/cJSON.h"
+#include "BuildReport.h"
+
+namespace UltraEd
+{
+	// Sizes of the engine's structures on the console where pointers are 32-bit.
+	const size_t modelBytes = 316;
+	const size_t meshBytes = 60;
+	const size_t vectorBytes = 24;
+	const size_t vertexBytes = 16;
+	const size_t mappingBytes = 12;
+	const size_t textureHeaderBytes = 16;
+	const size_t paletteBytes = 12;
+	const size_t textureBytes = 12;
+	const size_t commandBytes = 8;
+
+	// Assumed bookkeeping and alignment cost of each malloc.
+	const size_t allocationOverhead = 16;
+
+	// Commands emitted every frame by createDisplayList and for each sos_draw, and the
+	// call to the state list sos_draw adds whenever the texture changes.
+	const size_t frameCommands = 19;
+	const size_t modelCommands = 5;
+	const size_t stateCommands = 1;
+
+	// The translation and rotation sos_draw skips for models left at the origin unrotated.
+	const size_t placementCommands = 2;
+
+	// Commands in the state lists, which sos_build_texture makes once for each texture.
+	const size_t untexturedStateCommands = 8;
+	const size_t textureListCommands = 12;
+	const size_t mipmapCommands = 1;
+	const size_t paletteCommands = 6;
+	const size_t levelCommands = 7;
+	const size_t textureListCapacity = 20;
+
+	CBuildReport::CBuildReport()
+	{
+		BuildBudget budget = { 32 * 1024 * 1024, 512 * 1024, 2048, 1000000.0f / 30 };
+		m_budget = budget;
+		m_romBytes = m_heapBytes = m_displayListCommands = 0;
+		m_triangles = m_loadedVertices = 0;
+	}
+
+	CBuildReport::CBuildReport(const BuildBudget &budget)
+	{
+		m_budget = budget;
+		m_romBytes = m_heapBytes = m_displayListCommands = 0;
+		m_triangles = m_loadedVertices = 0;
+	}
+
+	void CBuildReport::Analyze(const vector<BuildActor> &actors, const vector<AssetEntry> &assets)
+	{
+		m_actors.clear();
+		m_warnings.clear();
+		m_assets = assets;
+		m_assetUsers = vector<vector<string>>(assets.size());
+		m_romBytes = assets.empty() ? 0 : assets.back().offset + assets.back().size;
+		m_heapBytes = 0;
+		m_triangles = m_loadedVertices = 0;
+		m_displayListCommands = FrameCommands();
+		vector<bool> stateChanges = StateChanges(actors);
+
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			const BuildActor &actor = actors[i];
+			ActorUsage usage = { actor.name, actor.type, 0, 0, 0, 0, 0 };
+			usage.heapBytes = Allocation(mappingBytes) + Allocation(actor.name.size() + 1);
+
+			if (actor.type == ActorType::Model)
+			{
+				bool textured = !actor.texturePath.empty();
+				usage.vertices = actor.loadedVertices;
+				usage.triangles = actor.vertexCount / 3;
+				usage.heapBytes += Allocation(modelBytes) + 3 * Allocation(vectorBytes);
+
+				// Every detail level has a mesh, vertices and display list of its own.
+				vector<MeshLevel> levels = actor.lods;
+				if (levels.empty()) levels.push_back(CBuildCore::LevelAt(actor, 0));
+				for (auto &level : levels)
+				{
+					usage.heapBytes += Allocation(meshBytes) + Allocation(level.loadedVertices * vertexBytes + 15)
+						+ Allocation((level.batchCount * 2 + level.triangles / 2 + 1) * commandBytes + 15);
+				}
+
+				usage.displayListCommands = DrawCommands(actor, stateChanges[i]);
+
+				if (actor.meshAsset >= 0 && actor.meshAsset < (int)assets.size())
+				{
+					size_t size = assets[actor.meshAsset].size;
+					usage.romBytes += size;
+					m_assetUsers[actor.meshAsset].push_back(actor.name);
+				}
+
+				if (textured && actor.textureAsset >= 0 && actor.textureAsset < (int)assets.size())
+				{
+					size_t size = assets[actor.textureAsset].size;
+					usage.romBytes += size;
+
+					// Models sharing a texture or atlas share its texels and texture list.
+					if (m_assetUsers[actor.textureAsset].empty())
+					{
+						usage.heapBytes += Allocation(textureBytes) + Allocation(size - min(size, textureHeaderBytes) + 15)
+							+ Allocation((textureListCapacity + actor.textureLevels * levelCommands) * commandBytes + 15);
+					}
+					m_assetUsers[actor.textureAsset].push_back(actor.name);
+				}
+
+				// Shared palettes are only loaded by the first model using them.
+				if (textured && actor.paletteEntries > 0 && actor.paletteAsset >= 0 && actor.paletteAsset < (int)assets.size())
+				{
+					size_t size = assets[actor.paletteAsset].size;
+					usage.romBytes += size;
+					if (m_assetUsers[actor.paletteAsset].empty())
+					{
+						usage.heapBytes += Allocation(paletteBytes) + Allocation(size + 15);
+					}
+					m_assetUsers[actor.paletteAsset].push_back(actor.name);
+				}
+			}
+			else if (actor.type == ActorType::Camera)
+			{
+				usage.heapBytes += Allocation(modelBytes) + 2 * Allocation(vectorBytes);
+			}
+
+			m_heapBytes += usage.heapBytes;
+			m_displayListCommands += usage.displayListCommands;
+			m_triangles += usage.triangles;
+			m_loadedVertices += usage.vertices;
+			m_actors.push_back(usage);
+		}
+
+
+		if (m_romBytes > m_budget.romBytes)
+		{
+			Warn("Assets take %u bytes of ROM but the budget is %u.",
+				(unsigned int)m_romBytes, (unsigned int)m_budget.romBytes);
+		}
+
+		if (m_heapBytes > m_budget.heapBytes)
+		{
+			Warn("The scene needs about %u bytes of heap but the budget is %u.",
+				(unsigned int)m_heapBytes, (unsigned int)m_budget.heapBytes);
+		}
+
+		if (m_displayListCommands > m_budget.displayListCommands)
+		{
+			Warn("A frame emits about %u display list commands but the budget is %u.",
+				(unsigned int)m_displayListCommands, (unsigned int)m_budget.displayListCommands);
+		}
+	}
+
+	string CBuildReport::ToJson()
+	{
+		cJSON *root = cJSON_CreateObject();
+
+		cJSON *budget = cJSON_CreateObject();
+		cJSON_AddNumberToObject(budget, "romBytes", (double)m_budget.romBytes);
+		cJSON_AddNumberToObject(budget, "heapBytes", (double)m_budget.heapBytes);
+		cJSON_AddNumberToObject(budget, "displayListCommands", (double)m_budget.displayListCommands);
+		cJSON_AddItemToObject(root, "budget", budget);
+
+		cJSON_AddNumberToObject(root, "romBytes", (double)m_romBytes);
+		cJSON_AddNumberToObject(root, "heapBytes", (double)m_heapBytes);
+		cJSON_AddNumberToObject(root, "displayListCommands", (double)m_displayListCommands);
+
+		// Without batching every triangle sent its own three vertices.
+		cJSON *transforms = cJSON_CreateObject();
+		cJSON_AddNumberToObject(transforms, "unbatched", m_triangles > 0 ? 3 : 0);
+		cJSON_AddNumberToObject(transforms, "batched", VerticesPerTriangle());
+		cJSON_AddItemToObject(root, "verticesPerTriangle", transforms);
+
+		cJSON *actorArray = cJSON_CreateArray();
+		for (auto &usage : m_actors)
+		{
+			cJSON *actor = cJSON_CreateObject();
+			cJSON_AddStringToObject(actor, "name", usage.name.c_str());
+			cJSON_AddStringToObject(actor, "type", usage.type == ActorType::Model ? "model" : "camera");
+			cJSON_AddNumberToObject(actor, "vertices", usage.vertices);
+			cJSON_AddNumberToObject(actor, "triangles", usage.triangles);
+			cJSON_AddNumberToObject(actor, "romBytes", (double)usage.romBytes);
+			cJSON_AddNumberToObject(actor, "heapBytes", (double)usage.heapBytes);
+			cJSON_AddNumberToObject(actor, "displayListCommands", (double)usage.displayListCommands);
+			cJSON_AddItemToArray(actorArray, actor);
+		}
+		cJSON_AddItemToObject(root, "actors", actorArray);
+
+		cJSON *assetArray = cJSON_CreateArray();
+		for (size_t i = 0; i < m_assets.size(); i++)
+		{
+			cJSON *asset = cJSON_CreateObject();
+			cJSON_AddNumberToObject(asset, "index", (double)i);
+			cJSON_AddNumberToObject(asset, "offset", m_assets[i].offset);
+			cJSON_AddNumberToObject(asset, "romBytes", m_assets[i].size);
+
+			cJSON *users = cJSON_CreateArray();
+			for (auto &user : m_assetUsers[i]) cJSON_AddItemToArray(users, cJSON_CreateString(user.c_str()));
+			cJSON_AddItemToObject(asset, "users", users);
+			cJSON_AddItemToArray(assetArray, asset);
+		}
+		cJSON_AddItemToObject(root, "assets", assetArray);
+
+		cJSON *warningArray = cJSON_CreateArray();
+		for (auto &warning : m_warnings) cJSON_AddItemToArray(warningArray, cJSON_CreateString(warning.c_str()));
+		cJSON_AddItemToObject(root, "warnings", warningArray);
+
+		char *rendered = cJSON_Print(root);
+		string json(rendered);
+		free(rendered);
+		cJSON_Delete(root);
+		return json;
+	}
+
+	size_t CBuildReport::FrameCommands()
+	{
+		return frameCommands;
+	}
+
+	size_t CBuildReport::DrawCommands(const BuildActor &actor, bool changesState)
+	{
+		if (actor.type != ActorType::Model) return 0;
+
+		bool placed = actor.angle != 0 || actor.position[0] != 0 || actor.position[1] != 0 || actor.position[2] != 0;
+		return modelCommands - (placed ? 0 : placementCommands) + (changesState ? stateCommands : 0);
+	}
+
+	size_t CBuildReport::MeshListCommands(const BuildActor &actor)
+	{
+		if (actor.type != ActorType::Model) return 0;
+
+		return MeshListCommands(CBuildCore::LevelAt(actor, 0));
+	}
+
+	size_t CBuildReport::MeshListCommands(const MeshLevel &level)
+	{
+		// Each batch loads its vertices and then draws its triangles two at a time.
+		return level.batchCount + level.triangleCommands + 1;
+	}
+
+	vector<bool> CBuildReport::StateChanges(const vector<BuildActor> &actors)
+	{
+		vector<bool> changes(actors.size(), false);
+		const BuildActor *previous = NULL;
+		for (auto index : CBuildCore::DrawOrder(actors))
+		{
+			changes[index] = previous == NULL || CBuildCore::TextureKey(*previous) != CBuildCore::TextureKey(actors[index]);
+			previous = &actors[index];
+		}
+		return changes;
+	}
+
+	size_t CBuildReport::StateListCommands(const BuildActor &actor)
+	{
+		if (actor.type != ActorType::Model) return 0;
+		if (actor.texturePath.empty()) return untexturedStateCommands;
+
+		size_t commands = textureListCommands + actor.textureLevels * levelCommands;
+		if (actor.textureLevels > 1) commands += mipmapCommands;
+		if (actor.paletteEntries > 0) commands += paletteCommands;
+		return commands;
+	}
+
+	float CBuildReport::VerticesPerTriangle()
+	{
+		return m_triangles > 0 ? (float)m_loadedVertices / m_triangles : 0;
+	}
+
+	size_t CBuildReport::Allocation(size_t bytes)
+	{
+		return (bytes + 7) / 8 * 8 + allocationOverhead;
+	}
+
+	void CBuildReport::Warn(const char *format, ...)
+	{
+		char buffer[256];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		m_warnings.push_back(buffer);
+	}
+}
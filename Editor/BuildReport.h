@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "AssetBundle.h"
+#include "BuildCore.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Limits the scene has to fit into on the console. Defaults match the engine.
+	typedef struct
+	{
+		size_t romBytes;
+		size_t heapBytes;
+		size_t displayListCommands;
+		float frameMicroseconds;
+	} BuildBudget;
+
+	typedef struct
+	{
+		string name;
+		ActorType::Value type;
+		int vertices; // Transformed by the RSP each time it is drawn.
+		int triangles;
+		size_t romBytes;
+		size_t heapBytes;
+		size_t displayListCommands;
+	} ActorUsage;
+
+	// Estimates the ROM, heap and display list usage of a scene from what the engine
+	// allocates and emits for each actor, and warns when a budget is exceeded.
+	class CBuildReport
+	{
+	public:
+		CBuildReport();
+		CBuildReport(const BuildBudget &budget);
+		void Analyze(const vector<BuildActor> &actors, const vector<AssetEntry> &assets);
+		string ToJson();
+		const BuildBudget &GetBudget() { return m_budget; }
+		const vector<ActorUsage> &GetActors() { return m_actors; }
+		const vector<string> &GetWarnings() { return m_warnings; }
+		size_t GetRomBytes() { return m_romBytes; }
+		size_t GetHeapBytes() { return m_heapBytes; }
+		size_t GetDisplayListCommands() { return m_displayListCommands; }
+		float VerticesPerTriangle();
+		static size_t FrameCommands();
+		static size_t DrawCommands(const BuildActor &actor, bool changesState = true);
+		static vector<bool> StateChanges(const vector<BuildActor> &actors);
+		static size_t StateListCommands(const BuildActor &actor);
+		static size_t MeshListCommands(const BuildActor &actor);
+		static size_t MeshListCommands(const MeshLevel &level);
+
+	private:
+		static size_t Allocation(size_t bytes);
+		void Warn(const char *format, ...);
+
+	private:
+		BuildBudget m_budget;
+		vector<ActorUsage> m_actors;
+		vector<AssetEntry> m_assets;
+		vector<vector<string>> m_assetUsers;
+		vector<string> m_warnings;
+		size_t m_romBytes;
+		size_t m_heapBytes;
+		size_t m_displayListCommands;
+		int m_triangles;
+		int m_loadedVertices;
+	};
+}
@@ -13,7 +13,7 @@ namespace UltraEd
 	CCamera::CCamera(const CCamera &camera)
 	{
 		*this = camera;
-		m_vertexBuffer = 0;
+		m_bufferId = 0;
 		ResetId();
 	}
 
@@ -29,7 +29,7 @@ namespace UltraEd
 			device->SetTransform(D3DTS_WORLD, stack->GetTop());
 			device->SetStreamSource(0, buffer, sizeof(Vertex));
 			device->SetVertexShader(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1);
-			device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, GetVertices().size() / 3);
+			device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, GetVertexCount() / 3);
 
 			stack->Pop();
 		}
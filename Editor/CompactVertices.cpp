@@ -0,0 +1,144 @@
+#include <cfloat>
+#include <cmath>
+#include "CompactVertices.h"
+
+namespace UltraEd
+{
+	const float quantizeMax = 65535.0f;
+
+	CCompactVertices::CCompactVertices()
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			m_positionMin[i] = 0;
+			m_positionScale[i] = 0;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			m_uvMin[i] = 0;
+			m_uvScale[i] = 0;
+		}
+	}
+
+	void CCompactVertices::Encode(const float *vertices, size_t count)
+	{
+		float positionMax[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		float uvMax[2] = { -FLT_MAX, -FLT_MAX };
+
+		for (int i = 0; i < 3; i++) m_positionMin[i] = count ? FLT_MAX : 0;
+		for (int i = 0; i < 2; i++) m_uvMin[i] = count ? FLT_MAX : 0;
+
+		// Find the bounds each component gets quantized against.
+		for (size_t i = 0; i < count; i++)
+		{
+			const float *vertex = &vertices[i * vertexFloats];
+			for (int j = 0; j < 3; j++)
+			{
+				m_positionMin[j] = fminf(m_positionMin[j], vertex[j]);
+				positionMax[j] = fmaxf(positionMax[j], vertex[j]);
+			}
+
+			for (int j = 0; j < 2; j++)
+			{
+				m_uvMin[j] = fminf(m_uvMin[j], vertex[6 + j]);
+				uvMax[j] = fmaxf(uvMax[j], vertex[6 + j]);
+			}
+		}
+
+		for (int i = 0; i < 3; i++)
+		{
+			m_positionScale[i] = count ? (positionMax[i] - m_positionMin[i]) / quantizeMax : 0;
+		}
+
+		for (int i = 0; i < 2; i++)
+		{
+			m_uvScale[i] = count ? (uvMax[i] - m_uvMin[i]) / quantizeMax : 0;
+		}
+
+		m_vertices.resize(count);
+		m_vertices.shrink_to_fit();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const float *vertex = &vertices[i * vertexFloats];
+			CompactVertex &compact = m_vertices[i];
+
+			for (int j = 0; j < 3; j++)
+			{
+				float value = m_positionScale[j] > 0 ? (vertex[j] - m_positionMin[j]) / m_positionScale[j] : 0;
+				compact.position[j] = (unsigned short)(value + 0.5f);
+			}
+
+			EncodeNormal(&vertex[3], compact.normal);
+
+			for (int j = 0; j < 2; j++)
+			{
+				float value = m_uvScale[j] > 0 ? (vertex[6 + j] - m_uvMin[j]) / m_uvScale[j] : 0;
+				compact.uv[j] = (unsigned short)(value + 0.5f);
+			}
+		}
+	}
+
+	void CCompactVertices::Decode(size_t index, float *vertex) const
+	{
+		const CompactVertex &compact = m_vertices[index];
+
+		DecodePosition(index, vertex);
+		DecodeNormal(compact.normal, &vertex[3]);
+
+		for (int i = 0; i < 2; i++)
+		{
+			vertex[6 + i] = m_uvMin[i] + compact.uv[i] * m_uvScale[i];
+		}
+	}
+
+	void CCompactVertices::DecodePosition(size_t index, float *position) const
+	{
+		const CompactVertex &compact = m_vertices[index];
+
+		for (int i = 0; i < 3; i++)
+		{
+			position[i] = m_positionMin[i] + compact.position[i] * m_positionScale[i];
+		}
+	}
+
+	void CCompactVertices::EncodeNormal(const float *normal, unsigned char *encoded)
+	{
+		float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+		float x = length > 0 ? normal[0] / length : 0;
+		float y = length > 0 ? normal[1] / length : 0;
+
+		// Fold the lower hemisphere over the diagonals of the octahedron.
+		if (normal[2] < 0)
+		{
+			float foldedX = (1 - fabsf(y)) * (x < 0 ? -1 : 1);
+			float foldedY = (1 - fabsf(x)) * (y < 0 ? -1 : 1);
+			x = foldedX;
+			y = foldedY;
+		}
+
+		encoded[0] = (unsigned char)floorf((x * 0.5f + 0.5f) * 255 + 0.5f);
+		encoded[1] = (unsigned char)floorf((y * 0.5f + 0.5f) * 255 + 0.5f);
+	}
+
+	void CCompactVertices::DecodeNormal(const unsigned char *encoded, float *normal)
+	{
+		float x = encoded[0] / 255.0f * 2 - 1;
+		float y = encoded[1] / 255.0f * 2 - 1;
+		float z = 1 - fabsf(x) - fabsf(y);
+
+		if (z < 0)
+		{
+			float unfoldedX = (1 - fabsf(y)) * (x < 0 ? -1 : 1);
+			float unfoldedY = (1 - fabsf(x)) * (y < 0 ? -1 : 1);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+
+		float length = sqrtf(x * x + y * y + z * z);
+		normal[0] = length > 0 ? x / length : 0;
+		normal[1] = length > 0 ? y / length : 0;
+		normal[2] = length > 0 ? z / length : 1;
+	}
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Position, normal and UV laid out as eight floats like Vertex.
+	const int vertexFloats = 8;
+
+	typedef struct
+	{
+		unsigned short position[3];
+		unsigned char normal[2];
+		unsigned short uv[2];
+	} CompactVertex;
+
+	// Stores vertices in 12 bytes instead of 32. Positions and UVs are quantized
+	// to 16 bits against the bounds of the mesh and normals are octahedral encoded.
+	class CCompactVertices
+	{
+	public:
+		CCompactVertices();
+		void Encode(const float *vertices, size_t count);
+		void Decode(size_t index, float *vertex) const;
+		void DecodePosition(size_t index, float *position) const;
+		size_t GetCount() const { return m_vertices.size(); }
+		size_t GetSize() const { return m_vertices.size() * sizeof(CompactVertex); }
+
+	private:
+		static void EncodeNormal(const float *normal, unsigned char *encoded);
+		static void DecodeNormal(const unsigned char *encoded, float *normal);
+
+	private:
+		vector<CompactVertex> m_vertices;
+		float m_positionMin[3];
+		float m_positionScale[3];
+		float m_uvMin[2];
+		float m_uvScale[2];
+	};
+}
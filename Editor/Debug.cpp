@@ -2,9 +2,11 @@
 
 namespace UltraEd
 {
+	const unsigned int lineCapacity = 16384;
+
 	CDebug* CDebug::m_instance = &Instance();
 
-	CDebug::CDebug()
+	CDebug::CDebug() : m_lines(lineCapacity)
 	{
 		m_vertexBuffer = 0;
 
@@ -25,9 +27,36 @@ namespace UltraEd
 		return *m_instance;
 	}
 
-	void CDebug::DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to)
+	void CDebug::DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to, float lifetime)
+	{
+		Instance().m_lines.AddLine(ToDebugVertex(from), ToDebugVertex(to), lifetime);
+	}
+
+	void CDebug::DrawBox(D3DXVECTOR3 min, D3DXVECTOR3 max, float lifetime)
+	{
+		Instance().m_lines.AddBox(ToDebugVertex(min), ToDebugVertex(max), lifetime);
+	}
+
+	void CDebug::DrawSphere(D3DXVECTOR3 center, float radius, float lifetime)
+	{
+		Instance().m_lines.AddSphere(ToDebugVertex(center), radius, lifetime);
+	}
+
+	void CDebug::DrawFrustum(D3DXMATRIX viewProjection, float lifetime)
 	{
-		Instance()._DrawLine(from, to);
+		D3DXMATRIX inverse;
+		if (D3DXMatrixInverse(&inverse, NULL, &viewProjection) == NULL) return;
+
+		// Unproject the corners of the clip space volume.
+		DebugVertex corners[8];
+		for (int i = 0; i < 8; i++)
+		{
+			D3DXVECTOR3 corner(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : 0.0f);
+			D3DXVec3TransformCoord(&corner, &corner, &inverse);
+			corners[i] = ToDebugVertex(corner);
+		}
+
+		Instance().m_lines.AddFrustum(corners, lifetime);
 	}
 
 	void CDebug::Log(const char *format, ...)
@@ -42,18 +71,10 @@ namespace UltraEd
 		va_end(args);
 	}
 
-	void CDebug::_DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to)
+	DebugVertex CDebug::ToDebugVertex(D3DXVECTOR3 vector)
 	{
-		Vertex v1;
-		v1.position = from;
-
-		Vertex v2;
-		v2.position = to;
-
-		m_vertices.push_back(v1);
-		m_vertices.push_back(v2);
-
-		Release();
+		DebugVertex vertex = { vector.x, vector.y, vector.z };
+		return vertex;
 	}
 
 	IDirect3DVertexBuffer8 *CDebug::GetBuffer(IDirect3DDevice8 *device)
@@ -61,8 +82,8 @@ namespace UltraEd
 		if (m_vertexBuffer == NULL)
 		{
 			if (FAILED(device->CreateVertexBuffer(
-				m_vertices.size() * sizeof(Vertex),
-				0,
+				m_lines.GetCapacity() * 2 * sizeof(DebugVertex),
+				D3DUSAGE_DYNAMIC | D3DUSAGE_WRITEONLY,
 				D3DFVF_XYZ,
 				D3DPOOL_DEFAULT,
 				&m_vertexBuffer)))
@@ -70,15 +91,8 @@ namespace UltraEd
 				return NULL;
 			}
 
-			VOID *pVertices;
-			if (FAILED(m_vertexBuffer->Lock(0, m_vertices.size() * sizeof(Vertex),
-				(BYTE**)&pVertices, 0)))
-			{
-				return NULL;
-			}
-
-			memcpy(pVertices, &m_vertices[0], m_vertices.size() * sizeof(Vertex));
-			m_vertexBuffer->Unlock();
+			// A fresh buffer holds nothing so everything alive must be written again.
+			m_lines.Lose();
 		}
 
 		return m_vertexBuffer;
@@ -87,16 +101,43 @@ namespace UltraEd
 	void CDebug::Render(IDirect3DDevice8 *device)
 	{
 		IDirect3DVertexBuffer8 *buffer = GetBuffer(device);
+		if (buffer == NULL) return;
+
+		m_lines.Prepare(timeGetTime() * 0.001f);
+
+		// Only the lines added since the last frame are appended to the ring.
+		const DebugWrite &write = m_lines.GetWrite();
+		if (write.count > 0)
+		{
+			VOID *pVertices;
+			UINT offset = write.start * 2 * sizeof(DebugVertex);
+			UINT size = write.count * 2 * sizeof(DebugVertex);
+			if (FAILED(buffer->Lock(offset, size, (BYTE**)&pVertices,
+				write.discard ? D3DLOCK_DISCARD : D3DLOCK_NOOVERWRITE)))
+			{
+				m_lines.Lose();
+				return;
+			}
+
+			memcpy(pVertices, &m_lines.GetStaging()[0], size);
+			buffer->Unlock();
+		}
+
+		device->SetMaterial(&m_material);
+		device->SetStreamSource(0, buffer, sizeof(DebugVertex));
+		device->SetVertexShader(D3DFVF_XYZ);
 
-		if (buffer != NULL)
+		for (auto run : m_lines.GetRuns())
 		{
-			device->SetMaterial(&m_material);
-			device->SetStreamSource(0, buffer, sizeof(Vertex));
-			device->SetVertexShader(D3DFVF_XYZ);
-			device->DrawPrimitive(D3DPT_LINELIST, 0, m_vertices.size() / 2);
+			device->DrawPrimitive(D3DPT_LINELIST, run.start * 2, run.count);
 		}
 	}
 
+	bool CDebug::IsAnimating()
+	{
+		return m_lines.IsAnimating();
+	}
+
 	void CDebug::Release()
 	{
 		if (m_vertexBuffer != NULL)
@@ -104,5 +145,7 @@ namespace UltraEd
 			m_vertexBuffer->Release();
 			m_vertexBuffer = 0;
 		}
+
+		m_lines.Lose();
 	}
 }
@@ -2,6 +2,7 @@
 
 #include <vector>
 #include "Vertex.h"
+#include "DebugLines.h"
 
 using namespace std;
 
@@ -14,8 +15,12 @@ namespace UltraEd
 		~CDebug();
 		void Release();
 		void Render(IDirect3DDevice8 *device);
+		bool IsAnimating();
 		static CDebug &Instance();
-		static void DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to);
+		static void DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to, float lifetime = 0);
+		static void DrawBox(D3DXVECTOR3 min, D3DXVECTOR3 max, float lifetime = 0);
+		static void DrawSphere(D3DXVECTOR3 center, float radius, float lifetime = 0);
+		static void DrawFrustum(D3DXMATRIX viewProjection, float lifetime = 0);
 		static void Log(const char *format, ...);
 
 	private:
@@ -23,7 +28,7 @@ namespace UltraEd
 		D3DMATERIAL8 m_material;
 		IDirect3DVertexBuffer8 *m_vertexBuffer;
 		IDirect3DVertexBuffer8 *GetBuffer(IDirect3DDevice8 *device);
-		vector<Vertex> m_vertices;
-		void _DrawLine(D3DXVECTOR3 from, D3DXVECTOR3 to);
+		CDebugLines m_lines;
+		static DebugVertex ToDebugVertex(D3DXVECTOR3 vector);
 	};
 }
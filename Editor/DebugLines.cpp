@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <cmath>
+#include "DebugLines.h"
+
+namespace UltraEd
+{
+	const int sphereSegments = 24;
+
+	CDebugLines::CDebugLines(unsigned int capacity)
+	{
+		m_capacity = capacity;
+		m_head = 0;
+		m_time = 0;
+		m_lost = true;
+
+		DebugWrite write = { 0, 0, false };
+		m_write = write;
+	}
+
+	void CDebugLines::AddLine(DebugVertex from, DebugVertex to, float lifetime)
+	{
+		// A lifetime of zero keeps the line around for a single frame.
+		DebugLine line = { from, to, m_time + lifetime, 0, false };
+		m_pending.push_back(line);
+	}
+
+	void CDebugLines::AddBox(DebugVertex min, DebugVertex max, float lifetime)
+	{
+		DebugVertex corners[8];
+		for (int i = 0; i < 8; i++)
+		{
+			corners[i].x = i & 1 ? max.x : min.x;
+			corners[i].y = i & 2 ? max.y : min.y;
+			corners[i].z = i & 4 ? max.z : min.z;
+		}
+
+		// Connect each corner to the neighbours differing in one axis.
+		for (int i = 0; i < 8; i++)
+		{
+			for (int axis = 1; axis < 8; axis <<= 1)
+			{
+				if (!(i & axis)) AddLine(corners[i], corners[i | axis], lifetime);
+			}
+		}
+	}
+
+	void CDebugLines::AddSphere(DebugVertex center, float radius, float lifetime)
+	{
+		const float step = 6.2831853f / sphereSegments;
+
+		// Draw a great circle around each axis.
+		for (int i = 0; i < sphereSegments; i++)
+		{
+			float c0 = cosf(step * i) * radius, s0 = sinf(step * i) * radius;
+			float c1 = cosf(step * (i + 1)) * radius, s1 = sinf(step * (i + 1)) * radius;
+
+			DebugVertex xy0 = { center.x + c0, center.y + s0, center.z };
+			DebugVertex xy1 = { center.x + c1, center.y + s1, center.z };
+			DebugVertex xz0 = { center.x + c0, center.y, center.z + s0 };
+			DebugVertex xz1 = { center.x + c1, center.y, center.z + s1 };
+			DebugVertex yz0 = { center.x, center.y + c0, center.z + s0 };
+			DebugVertex yz1 = { center.x, center.y + c1, center.z + s1 };
+
+			AddLine(xy0, xy1, lifetime);
+			AddLine(xz0, xz1, lifetime);
+			AddLine(yz0, yz1, lifetime);
+		}
+	}
+
+	void CDebugLines::AddFrustum(const DebugVertex corners[8], float lifetime)
+	{
+		// Corners are ordered like a box: bit 0 is x, bit 1 is y and bit 2 is near/far.
+		for (int i = 0; i < 8; i++)
+		{
+			for (int axis = 1; axis < 8; axis <<= 1)
+			{
+				if (!(i & axis)) AddLine(corners[i], corners[i | axis], lifetime);
+			}
+		}
+	}
+
+	void CDebugLines::Prepare(float time)
+	{
+		m_time = time;
+		m_staging.clear();
+		m_runs.clear();
+
+		DebugWrite write = { 0, 0, false };
+		m_write = write;
+
+		// Retire lines that were drawn at least once and have now expired.
+		m_live.erase(remove_if(m_live.begin(), m_live.end(), [time](const DebugLine &line) {
+			return line.drawn && line.expiresAt <= time;
+		}), m_live.end());
+
+		// Drop the oldest lines when more are alive than the ring can hold.
+		size_t total = m_live.size() + m_pending.size();
+		if (total > m_capacity)
+		{
+			size_t overflow = total - m_capacity;
+			size_t fromLive = min(overflow, m_live.size());
+			m_live.erase(m_live.begin(), m_live.begin() + fromLive);
+			m_pending.erase(m_pending.begin(), m_pending.begin() + (overflow - fromLive));
+		}
+
+		if (m_live.empty()) m_head = 0;
+
+		if (m_lost || m_head == 0 || m_head + m_pending.size() > m_capacity)
+		{
+			// Rewrite everything still alive from the start of the ring.
+			m_head = 0;
+			for (auto &line : m_live)
+			{
+				line.slot = m_head++;
+				Stage(line);
+			}
+
+			m_write.discard = true;
+			m_lost = false;
+		}
+		else
+		{
+			m_write.start = m_head;
+		}
+
+		for (auto &line : m_pending)
+		{
+			line.slot = m_head++;
+			Stage(line);
+			m_live.push_back(line);
+		}
+
+		m_pending.clear();
+		m_write.count = m_staging.size() / 2;
+
+		// Live lines keep their slot order so neighbouring slots draw as one run.
+		for (auto &line : m_live)
+		{
+			line.drawn = true;
+
+			if (!m_runs.empty() && m_runs.back().start + m_runs.back().count == line.slot)
+			{
+				m_runs.back().count++;
+			}
+			else
+			{
+				DebugRun run = { line.slot, 1 };
+				m_runs.push_back(run);
+			}
+		}
+	}
+
+	void CDebugLines::Lose()
+	{
+		m_lost = true;
+	}
+
+	bool CDebugLines::IsAnimating()
+	{
+		// Any live line still needs a later frame to be retired.
+		return !m_pending.empty() || !m_live.empty();
+	}
+
+	void CDebugLines::Stage(const DebugLine &line)
+	{
+		m_staging.push_back(line.from);
+		m_staging.push_back(line.to);
+	}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		float x, y, z;
+	} DebugVertex;
+
+	typedef struct
+	{
+		DebugVertex from;
+		DebugVertex to;
+		float expiresAt;
+		unsigned int slot;
+		bool drawn;
+	} DebugLine;
+
+	typedef struct
+	{
+		unsigned int start;
+		unsigned int count;
+		bool discard;
+	} DebugWrite;
+
+	typedef struct
+	{
+		unsigned int start;
+		unsigned int count;
+	} DebugRun;
+
+	// Tracks debug lines living in a fixed size ring of line slots. Each frame only the
+	// lines added since the last frame need to be written, and a full rewrite happens
+	// only when the ring wraps or the device buffer was lost.
+	class CDebugLines
+	{
+	public:
+		CDebugLines(unsigned int capacity);
+		void AddLine(DebugVertex from, DebugVertex to, float lifetime);
+		void AddBox(DebugVertex min, DebugVertex max, float lifetime);
+		void AddSphere(DebugVertex center, float radius, float lifetime);
+		void AddFrustum(const DebugVertex corners[8], float lifetime);
+		void Prepare(float time);
+		void Lose();
+		bool IsAnimating();
+		unsigned int GetCapacity() { return m_capacity; }
+		const DebugWrite &GetWrite() { return m_write; }
+		const vector<DebugVertex> &GetStaging() { return m_staging; }
+		const vector<DebugRun> &GetRuns() { return m_runs; }
+
+	private:
+		void Stage(const DebugLine &line);
+
+	private:
+		unsigned int m_capacity;
+		unsigned int m_head;
+		float m_time;
+		bool m_lost;
+		deque<DebugLine> m_live;
+		vector<DebugLine> m_pending;
+		vector<DebugVertex> m_staging;
+		vector<DebugRun> m_runs;
+		DebugWrite m_write;
+	};
+}
@@ -32,6 +32,10 @@
 #define IDM_MENU_DUPLICATE_OBJECT 9002
 #define IDM_MENU_MODIFY_SCRIPT_OBJECT 9003
 #define IDM_MENU_ADD_TEXTURE 9004
+#define IDM_MENU_TEXTURE_WRAP 9005
+#define IDM_MENU_TEXTURE_MIRROR 9006
+#define IDM_MENU_TEXTURE_CLAMP 9007
+#define IDM_MENU_STATIC 9008
 #define IDM_STATUS_BAR 9999
 
 const int windowWidth = 800;
@@ -51,6 +55,42 @@ void RunAction(const char *message, const std::function<void()> &action)
 	if (statusBar) SendMessage(statusBar, SB_SETTEXT, 0, (LPARAM)"");
 }
 
+void ShowBuildProgress(HWND hWnd)
+{
+	static string stageName;
+	UltraEd::BuildEvent event;
+
+	while (scene.PollBuild(&event))
+	{
+		char status[256];
+		switch (event.type)
+		{
+		case UltraEd::BuildEventType::Stage:
+			stageName = event.text;
+			sprintf(status, "Building ROM (%d/%d): %s...", event.stage, event.stageCount, stageName.c_str());
+			break;
+		case UltraEd::BuildEventType::Output:
+			UltraEd::CDebug::Log("%.240s\n", event.text.c_str());
+			sprintf(status, "Building ROM (%d/%d): %s: %.160s", event.stage, event.stageCount, stageName.c_str(),
+				event.text.c_str());
+			break;
+		case UltraEd::BuildEventType::Finished:
+			if (event.result == UltraEd::BuildResult::Cancelled) strcpy(status, "Build cancelled");
+			else if (event.result == UltraEd::BuildResult::Failed) strcpy(status, "Build failed");
+			else strcpy(status, "Build finished");
+			break;
+		}
+
+		if (statusBar) SendMessage(statusBar, SB_SETTEXT, 0, (LPARAM)status);
+
+		if (event.type == UltraEd::BuildEventType::Finished && !event.text.empty())
+		{
+			bool succeeded = event.result == UltraEd::BuildResult::Succeeded;
+			MessageBox(hWnd, event.text.c_str(), succeeded ? "Success" : "Error", MB_OK);
+		}
+	}
+}
+
 BOOL CALLBACK ScriptEditorProc(HWND hWndDlg, UINT message, WPARAM wParam, LPARAM lParam)
 {
 	switch (message)
@@ -104,6 +144,9 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 	{
 		case WM_KEYDOWN:
 		{
+			// Gizmo modifier hotkeys are polled while drawing.
+			scene.Invalidate();
+
 			switch (LOWORD(wParam))
 			{
 			case VK_DELETE:
@@ -112,6 +155,12 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			case 'D':
 				if (GetKeyState(VK_CONTROL) & 0x8000) scene.Duplicate();
 				break;
+			case 'Z':
+				if (GetKeyState(VK_CONTROL) & 0x8000) scene.Undo();
+				break;
+			case 'Y':
+				if (GetKeyState(VK_CONTROL) & 0x8000) scene.Redo();
+				break;
 			}
 		}
 		case WM_COMMAND:
@@ -134,13 +183,19 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 				PostQuitMessage(0);
 				break;
 			case ID_FILE_BUILDROM:
-				RunAction("Building ROM...", [] { scene.OnBuildROM(UltraEd::BuildFlag::_); });
+				scene.OnBuildROM(UltraEd::BuildFlag::_);
 				break;
 			case ID_FILE_BUILDROM_AND_RUN:
-				RunAction("Building ROM...", [] { scene.OnBuildROM(UltraEd::BuildFlag::Run); });
+				scene.OnBuildROM(UltraEd::BuildFlag::Run);
 				break;
 			case ID_FILE_BUILDROM_AND_LOAD:
-				RunAction("Building ROM...", [] { scene.OnBuildROM(UltraEd::BuildFlag::Load); });
+				scene.OnBuildROM(UltraEd::BuildFlag::Load);
+				break;
+			case ID_FILE_CANCELBUILD:
+				scene.OnCancelBuild();
+				break;
+			case ID_FILE_ESTIMATEFRAMECOST:
+				scene.OnEstimateFrameCost();
 				break;
 			case ID_INSTALL_BUILD_TOOLS:
 			{
@@ -230,9 +285,26 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			case IDM_MENU_ADD_TEXTURE:
 				scene.OnApplyTexture();
 				break;
+			case IDM_MENU_TEXTURE_WRAP:
+				scene.SetTextureAddress(UltraEd::TextureAddress::Wrap);
+				break;
+			case IDM_MENU_TEXTURE_MIRROR:
+				scene.SetTextureAddress(UltraEd::TextureAddress::Mirror);
+				break;
+			case IDM_MENU_TEXTURE_CLAMP:
+				scene.SetTextureAddress(UltraEd::TextureAddress::Clamp);
+				break;
+			case IDM_MENU_STATIC:
+				scene.SetStatic(!scene.GetStatic());
+				break;
 			}
 			break;
 		}
+		case WM_BUILD_PROGRESS:
+		{
+			ShowBuildProgress(hWnd);
+			break;
+		}
 		case WM_MOUSEWHEEL:
 		{
 			scene.OnMouseWheel(HIWORD(wParam));
@@ -261,6 +333,19 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 					ClientToScreen(hWnd, &point);
 					HMENU menu = CreatePopupMenu();
 					AppendMenu(menu, MF_STRING, IDM_MENU_ADD_TEXTURE, _T("Add Texture"));
+
+					// Tick the addressing the selected model uses.
+					HMENU addressMenu = CreatePopupMenu();
+					UltraEd::TextureAddress::Value address = scene.GetTextureAddress();
+					AppendMenu(addressMenu, MF_STRING | (address == UltraEd::TextureAddress::Wrap ? MF_CHECKED : 0),
+						IDM_MENU_TEXTURE_WRAP, _T("Wrap"));
+					AppendMenu(addressMenu, MF_STRING | (address == UltraEd::TextureAddress::Mirror ? MF_CHECKED : 0),
+						IDM_MENU_TEXTURE_MIRROR, _T("Mirror"));
+					AppendMenu(addressMenu, MF_STRING | (address == UltraEd::TextureAddress::Clamp ? MF_CHECKED : 0),
+						IDM_MENU_TEXTURE_CLAMP, _T("Clamp"));
+					AppendMenu(menu, MF_POPUP, (UINT_PTR)addressMenu, _T("Texture Addressing"));
+					AppendMenu(menu, MF_STRING | (scene.GetStatic() ? MF_CHECKED : 0), IDM_MENU_STATIC, _T("Static"));
+
 					AppendMenu(menu, MF_STRING, IDM_MENU_MODIFY_SCRIPT_OBJECT, _T("Modify Script"));
 					AppendMenu(menu, MF_STRING, IDM_MENU_DELETE_OBJECT, _T("Delete"));
 					AppendMenu(menu, MF_STRING, IDM_MENU_DUPLICATE_OBJECT, _T("Duplicate"));
@@ -287,6 +372,18 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 			return 1;
 			break;
 		}
+		case WM_PAINT:
+		{
+			// Redraw the scene when any part of the window becomes uncovered.
+			ValidateRect(hWnd, NULL);
+			scene.Invalidate();
+			break;
+		}
+		case WM_ACTIVATE:
+		{
+			scene.SetBackground(LOWORD(wParam) == WA_INACTIVE);
+			return DefWindowProc(hWnd, message, wParam, lParam);
+		}
 		case WM_DESTROY:
 		{
 			PostQuitMessage(0);
@@ -448,7 +545,9 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine
 		}
 		else
 		{
-			scene.Render();
+			// Sleep until new input arrives or the scene's next frame is due.
+			DWORD waitTime = scene.Tick();
+			if (waitTime > 0) MsgWaitForMultipleObjects(0, NULL, FALSE, waitTime, QS_ALLINPUT);
 		}
 	}
 
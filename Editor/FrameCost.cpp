@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include "BuildReport.h"
+#include "FrameCost.h"
+
+namespace UltraEd
+{
+	// Rough F3DEX2 and RDP timings at 62.5 MHz.
+	const float rspVertexMicroseconds = 1.0f;
+	const float rspTriangleMicroseconds = 1.6f;
+	const float rspCommandMicroseconds = 0.15f;
+	const float rdpTriangleMicroseconds = 0.3f;
+	const float rdpTextureLoadMicroseconds = 5.0f;
+	const float rdpPixelMicroseconds = 0.064f;
+	const float rdpTexturedPixelMicroseconds = 0.08f;
+
+	// Both framebuffer clears run in fill mode at four pixels a cycle.
+	const float rdpClearMicroseconds = 2 * 320 * 240 / 4 / 62.5f;
+
+	// The engine's projection. SCREEN_WD / SCREEN_HT is integer division so the aspect is 1.
+	const float screenWidth = 320;
+	const float screenHeight = 240;
+	const float fieldOfView = 80;
+	const float nearPlane = 0.1f;
+	const float farPlane = 1000;
+
+	CFrameCost::CFrameCost(float frameMicroseconds)
+	{
+		m_frameMicroseconds = frameMicroseconds;
+	}
+
+	void CFrameCost::Analyze(const vector<BuildActor> &actors)
+	{
+		m_cameras.clear();
+		m_warnings.clear();
+
+		for (auto &camera : actors)
+		{
+			if (camera.type != ActorType::Camera) continue;
+
+			CameraCost cost = { camera.name, 0, rdpClearMicroseconds, CBuildReport::FrameCommands(), 0, 0, 0, vector<ActorCost>() };
+			cost.rspMicroseconds = cost.commands * rspCommandMicroseconds;
+			vector<bool> stateChanges = CBuildReport::StateChanges(actors);
+
+			// Every model is drawn whether the camera sees it or not.
+			for (size_t i = 0; i < actors.size(); i++)
+			{
+				const BuildActor &actor = actors[i];
+				if (actor.type != ActorType::Model) continue;
+
+				// Models drawn after another with the same texture skip its load.
+				bool textured = !actor.texturePath.empty();
+				bool loadsTexture = textured && stateChanges[i];
+				// Models far from the camera are drawn with a coarser level of detail.
+				MeshLevel level = CBuildCore::LevelAt(actor, Distance(actor, camera));
+				ActorCost actorCost = { actor.name, 0, 0, CBuildReport::DrawCommands(actor, stateChanges[i]),
+					level.loadedVertices, level.triangles, FillPixels(actor, camera) };
+
+				// The state and mesh lists are built at load but still cost the RSP to run.
+				size_t executed = actorCost.commands + CBuildReport::MeshListCommands(level)
+					+ (stateChanges[i] ? CBuildReport::StateListCommands(actor) : 0);
+				actorCost.rspMicroseconds = actorCost.vertices * rspVertexMicroseconds
+					+ actorCost.triangles * rspTriangleMicroseconds + executed * rspCommandMicroseconds;
+
+				// Trilinear filtering needs both cycles which halves the fill rate.
+				float pixelMicroseconds = !textured ? rdpPixelMicroseconds :
+					actor.textureLevels > 1 ? 2 * rdpTexturedPixelMicroseconds : rdpTexturedPixelMicroseconds;
+				actorCost.rdpMicroseconds = actorCost.triangles * rdpTriangleMicroseconds
+					+ actorCost.fillPixels * pixelMicroseconds;
+				if (loadsTexture) actorCost.rdpMicroseconds += rdpTextureLoadMicroseconds * actor.textureLevels;
+
+				cost.rspMicroseconds += actorCost.rspMicroseconds;
+				cost.rdpMicroseconds += actorCost.rdpMicroseconds;
+				cost.commands += actorCost.commands;
+				cost.vertices += actorCost.vertices;
+				cost.triangles += actorCost.triangles;
+				cost.fillPixels += actorCost.fillPixels;
+				cost.actors.push_back(actorCost);
+			}
+
+			sort(cost.actors.begin(), cost.actors.end(), [](const ActorCost &a, const ActorCost &b) {
+				return a.rspMicroseconds + a.rdpMicroseconds > b.rspMicroseconds + b.rdpMicroseconds;
+			});
+
+			// The RSP and RDP work in parallel so the slower of the two sets the frame time.
+			float frame = max(cost.rspMicroseconds, cost.rdpMicroseconds);
+			if (frame > m_frameMicroseconds)
+			{
+				char buffer[256];
+				snprintf(buffer, sizeof(buffer), "%s needs about %.2f ms per frame but the budget is %.2f ms.",
+					camera.name.c_str(), frame / 1000, m_frameMicroseconds / 1000);
+				m_warnings.push_back(buffer);
+			}
+
+			m_cameras.push_back(cost);
+		}
+
+		if (m_cameras.empty()) m_warnings.push_back("The scene has no camera to draw from.");
+	}
+
+	vector<string> CFrameCost::Summarize(size_t topActors)
+	{
+		vector<string> lines;
+		char buffer[256];
+
+		for (auto &camera : m_cameras)
+		{
+			snprintf(buffer, sizeof(buffer), "%s: RSP %.2f ms, RDP %.2f ms of %.2f ms, %u commands, %d triangles, %.0f pixels",
+				camera.camera.c_str(), camera.rspMicroseconds / 1000, camera.rdpMicroseconds / 1000,
+				m_frameMicroseconds / 1000, (unsigned int)camera.commands, camera.triangles, camera.fillPixels);
+			lines.push_back(buffer);
+
+			for (size_t i = 0; i < camera.actors.size() && i < topActors; i++)
+			{
+				const ActorCost &actor = camera.actors[i];
+				snprintf(buffer, sizeof(buffer), "    %s: RSP %.2f ms, RDP %.2f ms, %d triangles, %.0f pixels",
+					actor.name.c_str(), actor.rspMicroseconds / 1000, actor.rdpMicroseconds / 1000,
+					actor.triangles, actor.fillPixels);
+				lines.push_back(buffer);
+			}
+		}
+
+		lines.insert(lines.end(), m_warnings.begin(), m_warnings.end());
+		return lines;
+	}
+
+	float CFrameCost::Distance(const BuildActor &actor, const BuildActor &camera)
+	{
+		// Like the engine, from the middle of the bounds scaled but not rotated.
+		float squared = 0;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float middle = (actor.boundsMin[axis] + actor.boundsMax[axis]) / 2 * actor.scale[axis];
+			float offset = actor.position[axis] + middle - camera.position[axis];
+			squared += offset * offset;
+		}
+		return sqrt(squared);
+	}
+
+	float CFrameCost::FillPixels(const BuildActor &actor, const BuildActor &camera)
+	{
+		if (actor.vertexCount == 0) return 0;
+
+		float scale = tan(fieldOfView / 2 * 3.14159265f / 180);
+		float left = screenWidth, right = 0, top = screenHeight, bottom = 0;
+		bool visible = false;
+
+		// Project the corners of the actor's bounds into the camera's view.
+		for (int corner = 0; corner < 8; corner++)
+		{
+			float point[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				point[axis] = (corner & (1 << axis) ? actor.boundsMax[axis] : actor.boundsMin[axis]) * actor.scale[axis];
+			}
+
+			CBuildCore::Rotate(actor.axis, actor.angle, point);
+			for (int axis = 0; axis < 3; axis++) point[axis] += actor.position[axis] - camera.position[axis];
+			CBuildCore::Rotate(camera.axis, -camera.angle, point);
+
+			// Corners behind the near plane are pinned to it which only overestimates.
+			if (point[2] > farPlane) continue;
+			visible |= point[2] > nearPlane;
+			float depth = max(point[2], nearPlane);
+
+			float x = (point[0] / (depth * scale) + 1) * screenWidth / 2;
+			float y = (1 - point[1] / (depth * scale)) * screenHeight / 2;
+			left = min(left, x);
+			right = max(right, x);
+			top = min(top, y);
+			bottom = max(bottom, y);
+		}
+
+		if (!visible) return 0;
+
+		float width = min(right, screenWidth) - max(left, 0.0f);
+		float height = min(bottom, screenHeight) - max(top, 0.0f);
+		return width > 0 && height > 0 ? width * height : 0;
+	}
+}
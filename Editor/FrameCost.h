@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BuildCore.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		string name;
+		float rspMicroseconds;
+		float rdpMicroseconds;
+		size_t commands;
+		int vertices;
+		int triangles;
+		float fillPixels;
+	} ActorCost;
+
+	typedef struct
+	{
+		string camera;
+		float rspMicroseconds;
+		float rdpMicroseconds;
+		size_t commands;
+		int vertices;
+		int triangles;
+		float fillPixels;
+		vector<ActorCost> actors; // Most expensive first.
+	} CameraCost;
+
+	// Predicts how long the RSP and RDP spend on a frame of the scene as seen from
+	// each camera, from what sos_draw emits and how much of the screen each actor's
+	// bounds cover. Actors need their vertex counts and bounds measured first.
+	class CFrameCost
+	{
+	public:
+		CFrameCost(float frameMicroseconds = 1000000.0f / 30);
+		void Analyze(const vector<BuildActor> &actors);
+		vector<string> Summarize(size_t topActors);
+		const vector<CameraCost> &GetCameras() { return m_cameras; }
+		const vector<string> &GetWarnings() { return m_warnings; }
+
+	private:
+		static float Distance(const BuildActor &actor, const BuildActor &camera);
+		static float FillPixels(const BuildActor &actor, const BuildActor &camera);
+
+	private:
+		float m_frameMicroseconds;
+		vector<CameraCost> m_cameras;
+		vector<string> m_warnings;
+	};
+}
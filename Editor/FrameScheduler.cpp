@@ -0,0 +1,78 @@
+#include "FrameScheduler.h"
+
+namespace UltraEd
+{
+	const DWORD foregroundFrameInterval = 16; // milliseconds
+	const DWORD backgroundFrameInterval = 250; // milliseconds
+
+	CFrameScheduler::CFrameScheduler()
+	{
+		m_dirty = true;
+		m_continuous = false;
+		m_background = false;
+		m_idleThrottle = true;
+		m_lastFrameTime = 0;
+	}
+
+	void CFrameScheduler::Invalidate()
+	{
+		m_dirty = true;
+	}
+
+	void CFrameScheduler::SetContinuous(bool continuous)
+	{
+		// Draw one more frame when continuous updates stop so
+		// the scene can settle into its final state.
+		if (m_continuous && !continuous) m_dirty = true;
+		m_continuous = continuous;
+	}
+
+	void CFrameScheduler::SetBackground(bool background)
+	{
+		m_background = background;
+		m_dirty = true;
+	}
+
+	void CFrameScheduler::SetIdleThrottle(bool enabled)
+	{
+		m_idleThrottle = enabled;
+	}
+
+	bool CFrameScheduler::IsFrameDue(DWORD time)
+	{
+		return IsPending() && time - m_lastFrameTime >= GetFrameInterval();
+	}
+
+	DWORD CFrameScheduler::TimeUntilFrame(DWORD time)
+	{
+		if (!IsPending()) return INFINITE;
+
+		DWORD elapsed = time - m_lastFrameTime;
+		DWORD interval = GetFrameInterval();
+		return elapsed >= interval ? 0 : interval - elapsed;
+	}
+
+	float CFrameScheduler::BeginFrame(DWORD time)
+	{
+		// Coming out of an idle period would otherwise produce a huge
+		// step and make the view jump, so use a nominal frame instead.
+		DWORD elapsed = time - m_lastFrameTime;
+		if (elapsed > GetFrameInterval() * 4) elapsed = GetFrameInterval();
+
+		// Anything invalidated while drawing this frame schedules the next one.
+		m_dirty = false;
+		m_lastFrameTime = time;
+
+		return elapsed * 0.001f;
+	}
+
+	bool CFrameScheduler::IsPending()
+	{
+		return m_dirty || m_continuous;
+	}
+
+	DWORD CFrameScheduler::GetFrameInterval()
+	{
+		return m_background && m_idleThrottle ? backgroundFrameInterval : foregroundFrameInterval;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <windows.h>
+
+namespace UltraEd
+{
+	class CFrameScheduler
+	{
+	public:
+		CFrameScheduler();
+		void Invalidate();
+		void SetContinuous(bool continuous);
+		void SetBackground(bool background);
+		void SetIdleThrottle(bool enabled);
+		bool IsFrameDue(DWORD time);
+		DWORD TimeUntilFrame(DWORD time);
+		float BeginFrame(DWORD time);
+
+	private:
+		bool IsPending();
+		DWORD GetFrameInterval();
+
+	private:
+		bool m_dirty;
+		bool m_continuous;
+		bool m_background;
+		bool m_idleThrottle;
+		DWORD m_lastFrameTime;
+	};
+}
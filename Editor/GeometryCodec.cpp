@@ -0,0 +1,248 @@
+#include <algorithm>
+#include "GeometryCodec.h"
+
+namespace UltraEd
+{
+	// Counts are stored in a byte, bit widths in five bits and shifts in four.
+	const int countBits = 8;
+	const int widthBits = 5;
+	const int shiftBits = 4;
+
+	string CGeometryCodec::Encode(const vector<MeshBatch> &batches, const vector<short> &vertices)
+	{
+		CBitWriter writer;
+		size_t first = 0;
+		for (auto &batch : batches)
+		{
+			int vertexCount = (int)batch.vertices.size();
+			writer.Write(vertexCount, countBits);
+			writer.Write((unsigned int)batch.triangles.size() / 3, countBits);
+
+			// Positions are offsets from the smallest one in the batch, dropping the low bits
+			// they all leave clear, in as few bits as the largest needs.
+			const short *batchVertices = &vertices[first * codecShorts];
+			int base[3], positionWidths[3], positionShifts[3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				int low = batchVertices[axis], high = low;
+				unsigned int used = 0;
+				for (int i = 0; i < vertexCount; i++)
+				{
+					low = min(low, (int)batchVertices[i * codecShorts + axis]);
+					high = max(high, (int)batchVertices[i * codecShorts + axis]);
+				}
+				for (int i = 0; i < vertexCount; i++) used |= batchVertices[i * codecShorts + axis] - low;
+				base[axis] = low;
+				positionShifts[axis] = Shift(used);
+				positionWidths[axis] = Width((unsigned int)(high - low) >> positionShifts[axis]);
+				writer.Write((unsigned short)low, 16);
+				writer.Write(positionWidths[axis], widthBits);
+				writer.Write(positionShifts[axis], shiftBits);
+			}
+
+			// Neighbouring vertices are loaded close together so their coordinates differ little.
+			int uvWidths[2] = { 0, 0 }, uvShifts[2];
+			for (int axis = 0; axis < 2; axis++)
+			{
+				unsigned int used = 0;
+				for (int i = 1; i < vertexCount; i++)
+				{
+					used |= batchVertices[i * codecShorts + 3 + axis] - batchVertices[(i - 1) * codecShorts + 3 + axis];
+				}
+				uvShifts[axis] = Shift(used);
+				for (int i = 1; i < vertexCount; i++)
+				{
+					int delta = batchVertices[i * codecShorts + 3 + axis] - batchVertices[(i - 1) * codecShorts + 3 + axis];
+					uvWidths[axis] = max(uvWidths[axis], Width(ZigZag(delta >> uvShifts[axis])));
+				}
+				writer.Write((unsigned short)batchVertices[3 + axis], 16);
+				writer.Write(uvWidths[axis], widthBits);
+				writer.Write(uvShifts[axis], shiftBits);
+			}
+
+			for (int i = 0; i < vertexCount; i++)
+			{
+				const short *vertex = &batchVertices[i * codecShorts];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					writer.Write((unsigned int)(vertex[axis] - base[axis]) >> positionShifts[axis], positionWidths[axis]);
+				}
+				for (int axis = 0; axis < 2 && i > 0; axis++)
+				{
+					writer.Write(ZigZag((vertex[3 + axis] - vertex[3 + axis - codecShorts]) >> uvShifts[axis]), uvWidths[axis]);
+				}
+			}
+
+			// Slots are handed out in order of first use so a single bit marks the next new one.
+			int next = 0;
+			for (auto slot : batch.triangles)
+			{
+				if (slot == next)
+				{
+					writer.Write(1, 1);
+					next++;
+				}
+				else
+				{
+					writer.Write(0, 1);
+					writer.WriteGamma(next - slot);
+				}
+			}
+			first += vertexCount;
+		}
+		return writer.Finish();
+	}
+
+	bool CGeometryCodec::Decode(const string &stream, int batchCount, vector<short> *vertices, vector<unsigned char> *table)
+	{
+		CBitReader reader(stream);
+		vector<unsigned char> slots;
+		vertices->clear();
+		table->clear();
+		for (int batch = 0; batch < batchCount; batch++)
+		{
+			unsigned int vertexCount, triangleCount, value;
+			if (!reader.Read(countBits, &vertexCount) || !reader.Read(countBits, &triangleCount)) return false;
+			table->push_back((unsigned char)vertexCount);
+			table->push_back((unsigned char)triangleCount);
+
+			unsigned int base[3], positionWidths[3], positionShifts[3], first[2], uvWidths[2], uvShifts[2];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (!reader.Read(16, &base[axis]) || !reader.Read(widthBits, &positionWidths[axis])
+					|| !reader.Read(shiftBits, &positionShifts[axis])) return false;
+			}
+			for (int axis = 0; axis < 2; axis++)
+			{
+				if (!reader.Read(16, &first[axis]) || !reader.Read(widthBits, &uvWidths[axis])
+					|| !reader.Read(shiftBits, &uvShifts[axis])) return false;
+			}
+
+			for (unsigned int i = 0; i < vertexCount; i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					if (!reader.Read(positionWidths[axis], &value)) return false;
+					vertices->push_back((short)(base[axis] + (value << positionShifts[axis])));
+				}
+				for (int axis = 0; axis < 2; axis++)
+				{
+					if (i == 0)
+					{
+						vertices->push_back((short)first[axis]);
+						continue;
+					}
+					if (!reader.Read(uvWidths[axis], &value)) return false;
+					int delta = (int)(value >> 1) ^ -(int)(value & 1);
+					vertices->push_back((short)(vertices->at(vertices->size() - codecShorts) + delta * (1 << uvShifts[axis])));
+				}
+			}
+
+			unsigned int next = 0;
+			for (unsigned int corner = 0; corner < triangleCount * 3; corner++)
+			{
+				if (!reader.Read(1, &value)) return false;
+				if (value == 1)
+				{
+					slots.push_back((unsigned char)next++);
+					continue;
+				}
+				if (!reader.ReadGamma(&value) || value > next) return false;
+				slots.push_back((unsigned char)(next - value));
+			}
+		}
+		table->insert(table->end(), slots.begin(), slots.end());
+		return true;
+	}
+
+	int CGeometryCodec::Width(unsigned int value)
+	{
+		int width = 0;
+		while (value >> width) width++;
+		return width;
+	}
+
+	int CGeometryCodec::Shift(unsigned int used)
+	{
+		// How many low bits every value leaves clear, with nothing set meaning none.
+		int shift = 0;
+		while (used != 0 && shift < 15 && (used >> shift & 1) == 0) shift++;
+		return shift;
+	}
+
+	unsigned int CGeometryCodec::ZigZag(int value)
+	{
+		// Small differences either way become small unsigned numbers.
+		return value < 0 ? ((unsigned int)-value << 1) - 1 : (unsigned int)value << 1;
+	}
+
+	CBitWriter::CBitWriter()
+	{
+		m_bits = 0;
+		m_count = 0;
+	}
+
+	void CBitWriter::Write(unsigned int value, int count)
+	{
+		// Most significant bit first, a byte at a time.
+		for (int bit = count - 1; bit >= 0; bit--)
+		{
+			m_bits = m_bits << 1 | (value >> bit & 1);
+			if (++m_count == 8)
+			{
+				m_data.push_back((char)m_bits);
+				m_bits = m_count = 0;
+			}
+		}
+	}
+
+	void CBitWriter::WriteGamma(unsigned int value)
+	{
+		// Elias gamma: as many zeros as bits follow the leading one.
+		int width = 0;
+		while (value >> (width + 1)) width++;
+		Write(0, width);
+		Write(value, width + 1);
+	}
+
+	string CBitWriter::Finish()
+	{
+		if (m_count > 0) Write(0, 8 - m_count);
+		string data;
+		data.swap(m_data);
+		return data;
+	}
+
+	CBitReader::CBitReader(const string &data) : m_data(data)
+	{
+		m_position = 0;
+	}
+
+	bool CBitReader::Read(int count, unsigned int *value)
+	{
+		*value = 0;
+		if (m_position + count > m_data.size() * 8) return false;
+
+		for (int i = 0; i < count; i++, m_position++)
+		{
+			*value = *value << 1 | ((unsigned char)m_data[m_position / 8] >> (7 - m_position % 8) & 1);
+		}
+		return true;
+	}
+
+	bool CBitReader::ReadGamma(unsigned int *value)
+	{
+		int width = 0;
+		unsigned int bit = 0;
+		while (Read(1, &bit) && bit == 0)
+		{
+			if (++width > 16) return false;
+		}
+		if (bit != 1) return false;
+
+		unsigned int rest;
+		if (!Read(width, &rest)) return false;
+		*value = 1u << width | rest;
+		return true;
+	}
+}
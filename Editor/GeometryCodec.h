@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "MeshBatcher.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Quantized position and texture coordinates of a vertex as the engine's Vtx holds them.
+	const int codecShorts = 5;
+
+	// Packs batched meshes into a bit stream the engine decodes straight into Vtx
+	// arrays. Each batch stores its positions as offsets from its own minimum, its
+	// texture coordinates as differences from the vertex loaded before and its
+	// triangles as either the next new vertex or how far back a used one was.
+	// Low bits every value in a batch leaves clear aren't stored.
+	class CGeometryCodec
+	{
+	public:
+		static string Encode(const vector<MeshBatch> &batches, const vector<short> &vertices);
+		static bool Decode(const string &stream, int batchCount, vector<short> *vertices, vector<unsigned char> *table);
+
+	private:
+		CGeometryCodec() {}
+		static int Width(unsigned int value);
+		static int Shift(unsigned int used);
+		static unsigned int ZigZag(int value);
+	};
+
+	class CBitWriter
+	{
+	public:
+		CBitWriter();
+		void Write(unsigned int value, int count);
+		void WriteGamma(unsigned int value);
+		string Finish();
+
+	private:
+		string m_data;
+		unsigned int m_bits;
+		int m_count;
+	};
+
+	class CBitReader
+	{
+	public:
+		CBitReader(const string &data);
+		bool Read(int count, unsigned int *value);
+		bool ReadGamma(unsigned int *value);
+
+	private:
+		const string &m_data;
+		size_t m_position;
+	};
+}
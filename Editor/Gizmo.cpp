@@ -18,6 +18,12 @@ namespace UltraEd
 		SetupScaleHandles();
 		SetupRotateHandles();
 		Reset();
+
+		// Handles are the last buffers evicted when the pool is over its budget.
+		for (int i = 0; i < 9; i++)
+		{
+			m_models[i].SetBufferPriority(ResourcePriority::High);
+		}
 	}
 
 	CGizmo::~CGizmo()
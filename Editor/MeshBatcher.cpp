@@ -0,0 +1,136 @@
+#include <climits>
+#include <cstring>
+#include <map>
+#include <string>
+#include "CompactVertices.h"
+#include "MeshBatcher.h"
+
+namespace UltraEd
+{
+	// Triangle counts are stored in a byte.
+	const int maxBatchTriangles = 255;
+
+	void CMeshBatcher::Weld(const vector<float> &vertices, vector<int> *indices, vector<int> *sources)
+	{
+		// Normals aren't stored so corners with the same position and coordinates are the same vertex.
+		map<string, int> welded;
+		indices->clear();
+		sources->clear();
+		for (size_t i = 0; i + vertexFloats <= vertices.size(); i += vertexFloats)
+		{
+			string key((const char*)&vertices[i], 3 * sizeof(float));
+			key.append((const char*)&vertices[i + 6], 2 * sizeof(float));
+
+			auto existing = welded.find(key);
+			if (existing == welded.end())
+			{
+				existing = welded.insert(make_pair(key, (int)sources->size())).first;
+				sources->push_back((int)(i / vertexFloats));
+			}
+			indices->push_back(existing->second);
+		}
+	}
+
+	vector<MeshBatch> CMeshBatcher::Build(const vector<int> &indices, int vertexCount, int bufferSize)
+	{
+		int triangleCount = (int)(indices.size() / 3);
+
+		// Triangles using each vertex, to find the ones next to what a batch already loaded.
+		vector<vector<int>> users(vertexCount);
+		for (int i = 0; i < triangleCount * 3; i++) users[indices[i]].push_back(i / 3);
+
+		vector<int> remaining(vertexCount), slots(vertexCount, -1);
+		for (int i = 0; i < vertexCount; i++) remaining[i] = (int)users[i].size();
+
+		vector<bool> emitted(triangleCount, false);
+		vector<MeshBatch> batches;
+		int next = 0;
+		while (true)
+		{
+			while (next < triangleCount && emitted[next]) next++;
+			if (next == triangleCount) break;
+
+			MeshBatch batch;
+			int triangle = next;
+			while (triangle >= 0)
+			{
+				emitted[triangle] = true;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					int vertex = indices[triangle * 3 + corner];
+					if (slots[vertex] < 0)
+					{
+						slots[vertex] = (int)batch.vertices.size();
+						batch.vertices.push_back(vertex);
+					}
+					batch.triangles.push_back((unsigned char)slots[vertex]);
+					remaining[vertex]--;
+				}
+				if ((int)batch.triangles.size() / 3 == maxBatchTriangles) break;
+
+				// Grow towards the neighbour needing the fewest new vertices, then the one
+				// whose vertices have the fewest triangles left so they can be dropped sooner.
+				triangle = -1;
+				int bestNew = INT_MAX, bestRemaining = INT_MAX;
+				for (auto vertex : batch.vertices)
+				{
+					for (auto user : users[vertex])
+					{
+						if (emitted[user]) continue;
+
+						int added = NewVertices(&indices[user * 3], slots);
+						if ((int)batch.vertices.size() + added > bufferSize) continue;
+
+						int left = remaining[indices[user * 3]] + remaining[indices[user * 3 + 1]] + remaining[indices[user * 3 + 2]];
+						if (added < bestNew || (added == bestNew && left < bestRemaining))
+						{
+							triangle = user;
+							bestNew = added;
+							bestRemaining = left;
+						}
+					}
+				}
+
+				// With no neighbour left to add, carry on with the next triangle in order if it fits.
+				if (triangle < 0)
+				{
+					while (next < triangleCount && emitted[next]) next++;
+					if (next < triangleCount && (int)batch.vertices.size() + NewVertices(&indices[next * 3], slots) <= bufferSize)
+					{
+						triangle = next;
+					}
+				}
+			}
+
+			for (auto vertex : batch.vertices) slots[vertex] = -1;
+			batches.push_back(batch);
+		}
+		return batches;
+	}
+
+	int CMeshBatcher::LoadedVertices(const vector<MeshBatch> &batches)
+	{
+		int loaded = 0;
+		for (auto &batch : batches) loaded += (int)batch.vertices.size();
+		return loaded;
+	}
+
+	int CMeshBatcher::TriangleCommands(const vector<MeshBatch> &batches)
+	{
+		// Triangles are drawn in pairs with one more on its own when a batch has an odd count.
+		int commands = 0;
+		for (auto &batch : batches) commands += ((int)batch.triangles.size() / 3 + 1) / 2;
+		return commands;
+	}
+
+	int CMeshBatcher::NewVertices(const int *triangle, const vector<int> &slots)
+	{
+		int added = 0;
+		for (int corner = 0; corner < 3; corner++)
+		{
+			bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+			if (slots[triangle[corner]] < 0 && !repeated) added++;
+		}
+		return added;
+	}
+}
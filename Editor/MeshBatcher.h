@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		vector<int> vertices;            // Welded vertices in the order they are loaded.
+		vector<unsigned char> triangles; // Three slots of the loaded vertices per triangle.
+	} MeshBatch;
+
+	// Turns triangle soups into batches that each fit the RSP's vertex buffer, so a
+	// vertex shared by neighbouring triangles is only transformed once per load.
+	class CMeshBatcher
+	{
+	public:
+		static void Weld(const vector<float> &vertices, vector<int> *indices, vector<int> *sources);
+		static vector<MeshBatch> Build(const vector<int> &indices, int vertexCount, int bufferSize = 32);
+		static int LoadedVertices(const vector<MeshBatch> &batches);
+		static int TriangleCommands(const vector<MeshBatch> &batches);
+
+	private:
+		CMeshBatcher() {}
+		static int NewVertices(const int *triangle, const vector<int> &slots);
+	};
+}
@@ -0,0 +1,201 @@
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <queue>
+#include "CompactVertices.h"
+#include "MeshBatcher.h"
+#include "MeshSimplifier.h"
+
+namespace UltraEd
+{
+	// How much more moving a vertex off an open edge costs than off a face, so
+	// outlines and texture seams hold their shape.
+	const double borderWeight = 10;
+
+	vector<float> CMeshSimplifier::Simplify(const vector<float> &vertices, int targetTriangles)
+	{
+		// Corners with the same position and coordinates are the same vertex, as when batching.
+		vector<int> indices, sources;
+		CMeshBatcher::Weld(vertices, &indices, &sources);
+		int vertexCount = (int)sources.size(), triangleCount = (int)(indices.size() / 3);
+		auto position = [&vertices, &sources](int vertex) { return &vertices[sources[vertex] * vertexFloats]; };
+
+		Quadric empty = { { 0 } };
+		vector<Quadric> quadrics(vertexCount, empty);
+		vector<vector<int>> users(vertexCount);
+		map<pair<int, int>, int> edges;
+		for (int triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const int *corners = &indices[triangle * 3];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				users[corners[corner]].push_back(triangle);
+				int a = corners[corner], b = corners[(corner + 1) % 3];
+				edges[make_pair(min(a, b), max(a, b))]++;
+			}
+
+			// Each face's plane weighted by its area.
+			double normal[3];
+			const float *a = position(corners[0]);
+			if (!Normal(a, position(corners[1]), position(corners[2]), normal)) continue;
+			double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			double plane[4] = { normal[0] / length, normal[1] / length, normal[2] / length, 0 };
+			plane[3] = -(plane[0] * a[0] + plane[1] * a[1] + plane[2] * a[2]);
+			for (int corner = 0; corner < 3; corner++) AddPlane(quadrics[corners[corner]], plane, length / 2);
+		}
+
+		// Edges used by a single face get a plane through them standing up from it.
+		for (int triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const int *corners = &indices[triangle * 3];
+			double normal[3];
+			if (!Normal(position(corners[0]), position(corners[1]), position(corners[2]), normal)) continue;
+
+			for (int corner = 0; corner < 3; corner++)
+			{
+				int a = corners[corner], b = corners[(corner + 1) % 3];
+				if (edges[make_pair(min(a, b), max(a, b))] != 1) continue;
+
+				const float *start = position(a), *end = position(b);
+				double edge[3] = { end[0] - start[0], end[1] - start[1], end[2] - start[2] };
+				double plane[4] = {
+					edge[1] * normal[2] - edge[2] * normal[1],
+					edge[2] * normal[0] - edge[0] * normal[2],
+					edge[0] * normal[1] - edge[1] * normal[0],
+					0
+				};
+				double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+				if (length == 0) continue;
+
+				for (int axis = 0; axis < 3; axis++) plane[axis] /= length;
+				plane[3] = -(plane[0] * start[0] + plane[1] * start[1] + plane[2] * start[2]);
+				double weight = borderWeight * (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]);
+				AddPlane(quadrics[a], plane, weight);
+				AddPlane(quadrics[b], plane, weight);
+			}
+		}
+
+		// Cheapest collapses come first. Ones queued before either end changed are skipped.
+		auto later = [](const Collapse &a, const Collapse &b) { return a.cost > b.cost; };
+		priority_queue<Collapse, vector<Collapse>, decltype(later)> queue(later);
+		vector<int> versions(vertexCount, 0);
+		auto offer = [&](int a, int b) {
+			double toB = Error(quadrics[a], quadrics[b], position(b));
+			double toA = Error(quadrics[a], quadrics[b], position(a));
+			Collapse collapse = { min(toA, toB), toB <= toA ? a : b, toB <= toA ? b : a, 0, 0 };
+			collapse.fromVersion = versions[collapse.from];
+			collapse.toVersion = versions[collapse.to];
+			queue.push(collapse);
+		};
+		for (auto &edge : edges) offer(edge.first.first, edge.first.second);
+
+		vector<bool> removed(triangleCount, false), collapsed(vertexCount, false);
+		int remaining = triangleCount;
+		while (remaining > targetTriangles && !queue.empty())
+		{
+			Collapse collapse = queue.top();
+			queue.pop();
+			int from = collapse.from, to = collapse.to;
+			if (collapsed[from] || collapsed[to] || versions[from] != collapse.fromVersion
+				|| versions[to] != collapse.toVersion) continue;
+
+			// Faces that would turn over once moved block the collapse.
+			bool flips = false;
+			for (auto triangle : users[from])
+			{
+				int *corners = &indices[triangle * 3];
+				if (removed[triangle] || corners[0] == to || corners[1] == to || corners[2] == to) continue;
+
+				const float *moved[3];
+				for (int corner = 0; corner < 3; corner++) moved[corner] = position(corners[corner] == from ? to : corners[corner]);
+				double before[3], after[3];
+				if (!Normal(position(corners[0]), position(corners[1]), position(corners[2]), before)) continue;
+				flips = !Normal(moved[0], moved[1], moved[2], after)
+					|| before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0;
+				if (flips) break;
+			}
+			if (flips) continue;
+
+			collapsed[from] = true;
+			versions[to]++;
+			for (int term = 0; term < 10; term++) quadrics[to].terms[term] += quadrics[from].terms[term];
+			for (auto triangle : users[from])
+			{
+				if (removed[triangle]) continue;
+
+				int *corners = &indices[triangle * 3];
+				if (corners[0] == to || corners[1] == to || corners[2] == to)
+				{
+					removed[triangle] = true;
+					remaining--;
+					continue;
+				}
+				for (int corner = 0; corner < 3; corner++)
+				{
+					if (corners[corner] == from) corners[corner] = to;
+				}
+				users[to].push_back(triangle);
+			}
+
+			// Every edge around the kept vertex costs something different now.
+			for (auto triangle : users[to])
+			{
+				if (removed[triangle]) continue;
+				for (int corner = 0; corner < 3; corner++)
+				{
+					int neighbour = indices[triangle * 3 + corner];
+					if (neighbour != to) offer(to, neighbour);
+				}
+			}
+		}
+
+		vector<float> simplified;
+		for (int triangle = 0; triangle < triangleCount; triangle++)
+		{
+			if (removed[triangle]) continue;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const float *vertex = position(indices[triangle * 3 + corner]);
+				simplified.insert(simplified.end(), vertex, vertex + vertexFloats);
+			}
+		}
+		return simplified;
+	}
+
+	void CMeshSimplifier::AddPlane(Quadric &quadric, const double plane[4], double weight)
+	{
+		int term = 0;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = row; column < 4; column++) quadric.terms[term++] += plane[row] * plane[column] * weight;
+		}
+	}
+
+	double CMeshSimplifier::Error(const Quadric &a, const Quadric &b, const float *point)
+	{
+		// The squared distance to every plane either vertex gathered, v^T (A + B) v.
+		double v[4] = { point[0], point[1], point[2], 1 };
+		double error = 0;
+		int term = 0;
+		for (int row = 0; row < 4; row++)
+		{
+			for (int column = row; column < 4; column++)
+			{
+				double sum = a.terms[term] + b.terms[term];
+				error += (row == column ? 1 : 2) * sum * v[row] * v[column];
+				term++;
+			}
+		}
+		return fabs(error);
+	}
+
+	bool CMeshSimplifier::Normal(const float *a, const float *b, const float *c, double normal[3])
+	{
+		double u[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+		double v[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+		normal[0] = u[1] * v[2] - u[2] * v[1];
+		normal[1] = u[2] * v[0] - u[0] * v[2];
+		normal[2] = u[0] * v[1] - u[1] * v[0];
+		return normal[0] != 0 || normal[1] != 0 || normal[2] != 0;
+	}
+}
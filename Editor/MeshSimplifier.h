@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Reduces triangle soups by collapsing the edges whose removal moves the surface
+	// the least, measured with the quadric error of the planes meeting at each vertex.
+	class CMeshSimplifier
+	{
+	public:
+		static vector<float> Simplify(const vector<float> &vertices, int targetTriangles);
+
+	private:
+		typedef struct
+		{
+			double terms[10]; // The upper half of the symmetric 4x4 matrix.
+		} Quadric;
+
+		typedef struct
+		{
+			double cost;
+			int from;
+			int to;
+			int fromVersion;
+			int toVersion;
+		} Collapse;
+
+		CMeshSimplifier() {}
+		static void AddPlane(Quadric &quadric, const double plane[4], double weight);
+		static double Error(const Quadric &a, const Quadric &b, const float *point);
+		static bool Normal(const float *a, const float *b, const float *c, double normal[3]);
+	};
+}
@@ -6,21 +6,31 @@ namespace UltraEd
 	CModel::CModel()
 	{
 		m_texture = 0;
+		m_textureAddress = TextureAddress::Wrap;
+		m_static = false;
 		ResetId();
 	}
 
 	CModel::CModel(const CModel &model)
 	{
 		*this = model;
-		m_vertexBuffer = 0;
+		m_bufferId = 0;
 		m_texture = 0;
 		ResetId();
 	}
 
+	CModel::~CModel()
+	{
+		// Deleted models kept alive for undo still own their texture.
+		if (m_texture != NULL) m_texture->Release();
+	}
+
 	CModel::CModel(const char *filePath)
 	{
 		Import(filePath);
 		m_texture = 0;
+		m_textureAddress = TextureAddress::Wrap;
+		m_static = false;
 		m_type = ActorType::Model;
 		m_collisionRadius = 1;
 	}
@@ -36,11 +46,16 @@ namespace UltraEd
 
 			if (m_texture != NULL) device->SetTexture(0, m_texture);
 
+			// Preview the same addressing the console will use.
+			D3DTEXTUREADDRESS address = m_textureAddress == TextureAddress::Clamp ? D3DTADDRESS_CLAMP :
+				m_textureAddress == TextureAddress::Mirror ? D3DTADDRESS_MIRROR : D3DTADDRESS_WRAP;
+			device->SetTextureStageState(0, D3DTSS_ADDRESSU, address);
+			device->SetTextureStageState(0, D3DTSS_ADDRESSV, address);
 			device->SetTextureStageState(0, D3DTSS_MAGFILTER, D3DTEXF_LINEAR);
 			device->SetTransform(D3DTS_WORLD, stack->GetTop());
 			device->SetStreamSource(0, buffer, sizeof(Vertex));
 			device->SetVertexShader(D3DFVF_XYZ | D3DFVF_NORMAL | D3DFVF_TEX1);
-			device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, GetVertices().size() / 3);
+			device->DrawPrimitive(D3DPT_TRIANGLELIST, 0, GetVertexCount() / 3);
 			device->SetTexture(0, NULL);
 
 			stack->Pop();
@@ -60,30 +75,82 @@ namespace UltraEd
 		}
 	}
 
+	size_t CModel::GetMemoryBytes()
+	{
+		size_t bytes = CActor::GetMemoryBytes();
+		if (m_texture == NULL) return bytes;
+
+		// Managed textures keep a copy of every level in system memory.
+		for (DWORD level = 0; level < m_texture->GetLevelCount(); level++)
+		{
+			D3DSURFACE_DESC desc;
+			if (SUCCEEDED(m_texture->GetLevelDesc(level, &desc))) bytes += desc.Size;
+		}
+		return bytes;
+	}
+
 	bool CModel::LoadTexture(IDirect3DDevice8 *device, const char *filePath)
 	{
 		FileInfo info = CFileIO::Import(filePath);
+		LPDIRECT3DTEXTURE8 texture = 0;
 
-		if (FAILED(D3DXCreateTextureFromFile(device, info.path.c_str(), &m_texture)))
+		if (FAILED(D3DXCreateTextureFromFile(device, info.path.c_str(), &texture)))
 		{
 			return false;
 		}
 
 		// Save location of texture for scene saving.
-		if (info.type == FileType::User) resources["textureDataPath"] = info.path;
+		SetTexture(texture, info.type == FileType::User ? info.path : string());
+		texture->Release();
 
 		return true;
 	}
 
+	void CModel::SetTexture(LPDIRECT3DTEXTURE8 texture, string path)
+	{
+		if (texture != NULL) texture->AddRef();
+		if (m_texture != NULL) m_texture->Release();
+		m_texture = texture;
+
+		if (path.empty())
+		{
+			resources.erase("textureDataPath");
+		}
+		else
+		{
+			resources["textureDataPath"] = path;
+		}
+	}
+
 	Savable CModel::Save()
 	{
-		return CActor::Save();
+		Savable savable = CActor::Save();
+		char buffer[LINE_FORMAT_LENGTH];
+		sprintf(buffer, "%i", (int)m_textureAddress);
+		cJSON_AddStringToObject(cJSON_GetObjectItem(savable.object, "actor"), "textureAddress", buffer);
+		sprintf(buffer, "%i", (int)m_static);
+		cJSON_AddStringToObject(cJSON_GetObjectItem(savable.object, "actor"), "static", buffer);
+		return savable;
 	}
 
 	bool CModel::Load(IDirect3DDevice8 *device, cJSON *root)
 	{
 		CActor::Load(device, root);
 
+		int address = TextureAddress::Wrap;
+		if (cJSON *textureAddress = cJSON_GetObjectItem(root, "textureAddress"))
+		{
+			sscanf(textureAddress->valuestring, "%i", &address);
+		}
+		m_textureAddress = (TextureAddress::Value)address;
+
+		int isStatic = 0;
+		if (cJSON *item = cJSON_GetObjectItem(root, "static"))
+		{
+			sscanf(item->valuestring, "%i", &isStatic);
+		}
+		m_static = isStatic != 0;
+
 		cJSON *resource = NULL;
 		cJSON *resources = cJSON_GetObjectItem(root, "resources");
 		cJSON_ArrayForEach(resource, resources)
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Actor.h"
+#include "TextureEncoder.h"
 
 using namespace std;
 
@@ -17,14 +18,24 @@ namespace UltraEd
 		CModel();
 		CModel(const char *filePath);
 		CModel(const CModel &model);
+		~CModel();
 		Savable Save();
 		bool Load(IDirect3DDevice8 *device, cJSON *root);
 		bool LoadTexture(IDirect3DDevice8 *device, const char *filePath);	
+		LPDIRECT3DTEXTURE8 GetTexture() { return m_texture; }
+		void SetTexture(LPDIRECT3DTEXTURE8 texture, string path);
+		TextureAddress::Value GetTextureAddress() { return m_textureAddress; }
+		void SetTextureAddress(TextureAddress::Value address) { m_textureAddress = address; }
+		bool IsStatic() { return m_static; }
+		void SetStatic(bool isStatic) { m_static = isStatic; }
+		size_t GetMemoryBytes();
 		void Release(ModelRelease::Value type);
 		void Render(IDirect3DDevice8 *device, ID3DXMatrixStack *stack);
 
 	private:
 		LPDIRECT3DTEXTURE8 m_texture;
+		TextureAddress::Value m_textureAddress;
+		bool m_static;
 		float m_collisionRadius;
 	};
 }
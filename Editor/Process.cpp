@@ -0,0 +1,188 @@
+#include "Process.h"
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace UltraEd
+{
+	// Exit code reported when the command could not be started or was killed.
+	const int failedExitCode = -1;
+
+	CProcess::CProcess()
+	{
+		m_cancelled = false;
+#ifdef _WIN32
+		m_job = NULL;
+		m_process = NULL;
+		m_output = NULL;
+#else
+		m_group = 0;
+		m_output = -1;
+#endif
+	}
+
+	int CProcess::Run(const string &command, const string &directory, function<void(const string &line)> output)
+	{
+		if (!Launch(command, directory)) return failedExitCode;
+
+		// Split the combined stdout and stderr into lines as it arrives.
+		string line;
+		char buffer[512];
+		while (true)
+		{
+#ifdef _WIN32
+			DWORD bytesRead = 0;
+			if (!ReadFile(m_output, buffer, sizeof(buffer), &bytesRead, NULL) || bytesRead == 0) break;
+#else
+			ssize_t bytesRead = read(m_output, buffer, sizeof(buffer));
+			if (bytesRead <= 0) break;
+#endif
+			for (int i = 0; i < (int)bytesRead; i++)
+			{
+				if (buffer[i] == '\n')
+				{
+					if (output) output(line);
+					line.clear();
+				}
+				else if (buffer[i] != '\r')
+				{
+					line.push_back(buffer[i]);
+				}
+			}
+		}
+		if (!line.empty() && output) output(line);
+
+		int exitCode = failedExitCode;
+#ifdef _WIN32
+		DWORD processExitCode;
+		WaitForSingleObject(m_process, INFINITE);
+		if (GetExitCodeProcess(m_process, &processExitCode)) exitCode = processExitCode;
+
+		lock_guard<mutex> guard(m_lock);
+		CloseHandle(m_output);
+		CloseHandle(m_process);
+		CloseHandle(m_job);
+		m_output = m_process = m_job = NULL;
+#else
+		int status;
+		if (waitpid(m_group, &status, 0) == m_group && WIFEXITED(status)) exitCode = WEXITSTATUS(status);
+
+		lock_guard<mutex> guard(m_lock);
+		close(m_output);
+		m_output = -1;
+		m_group = 0;
+#endif
+		return m_cancelled ? failedExitCode : exitCode;
+	}
+
+	void CProcess::Cancel()
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_cancelled = true;
+		Kill();
+	}
+
+	void CProcess::Reset()
+	{
+		lock_guard<mutex> guard(m_lock);
+		m_cancelled = false;
+	}
+
+	bool CProcess::IsCancelled()
+	{
+		lock_guard<mutex> guard(m_lock);
+		return m_cancelled;
+	}
+
+	bool CProcess::Launch(const string &command, const string &directory)
+	{
+		lock_guard<mutex> guard(m_lock);
+		if (m_cancelled) return false;
+
+#ifdef _WIN32
+		SECURITY_ATTRIBUTES attributes = { sizeof(attributes), NULL, TRUE };
+		HANDLE writeEnd;
+		if (!CreatePipe(&m_output, &writeEnd, &attributes, 0)) return false;
+		SetHandleInformation(m_output, HANDLE_FLAG_INHERIT, 0);
+
+		STARTUPINFO si;
+		PROCESS_INFORMATION pi;
+		ZeroMemory(&si, sizeof(si));
+		si.cb = sizeof(si);
+		si.dwFlags = STARTF_USESTDHANDLES;
+		si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+		si.hStdOutput = writeEnd;
+		si.hStdError = writeEnd;
+		ZeroMemory(&pi, sizeof(pi));
+
+		// Every process the command spawns joins the job so the tree can be killed at once.
+		m_job = CreateJobObject(NULL, NULL);
+		JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+		ZeroMemory(&limits, sizeof(limits));
+		limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+		SetInformationJobObject(m_job, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+
+		string commandLine = string("cmd /c ").append(command);
+		BOOL created = CreateProcess(NULL, &commandLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW | CREATE_SUSPENDED,
+			NULL, directory.c_str(), &si, &pi);
+		CloseHandle(writeEnd);
+
+		if (!created)
+		{
+			CloseHandle(m_output);
+			CloseHandle(m_job);
+			m_output = m_job = NULL;
+			return false;
+		}
+
+		AssignProcessToJobObject(m_job, pi.hProcess);
+		ResumeThread(pi.hThread);
+		CloseHandle(pi.hThread);
+		m_process = pi.hProcess;
+#else
+		int pipeEnds[2];
+		if (pipe(pipeEnds) != 0) return false;
+
+		pid_t child = fork();
+		if (child < 0)
+		{
+			close(pipeEnds[0]);
+			close(pipeEnds[1]);
+			return false;
+		}
+
+		if (child == 0)
+		{
+			// Lead a new process group so the tree can be killed at once.
+			setpgid(0, 0);
+			dup2(pipeEnds[1], STDOUT_FILENO);
+			dup2(pipeEnds[1], STDERR_FILENO);
+			close(pipeEnds[0]);
+			close(pipeEnds[1]);
+			if (chdir(directory.c_str()) != 0) _exit(127);
+			execl("/bin/sh", "sh", "-c", command.c_str(), (char*)NULL);
+			_exit(127);
+		}
+
+		// Set the group from both sides so a cancel can't race the child.
+		setpgid(child, child);
+		close(pipeEnds[1]);
+		fcntl(pipeEnds[0], F_SETFD, FD_CLOEXEC);
+		m_output = pipeEnds[0];
+		m_group = child;
+#endif
+		return true;
+	}
+
+	void CProcess::Kill()
+	{
+#ifdef _WIN32
+		if (m_job != NULL) TerminateJobObject(m_job, failedExitCode);
+#else
+		if (m_group > 0) kill(-m_group, SIGKILL);
+#endif
+	}
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/types.h>
+#endif
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Runs a shell command and streams its output line by line. Cancelling kills
+	// the whole process tree so build tools spawned by scripts don't linger.
+	class CProcess
+	{
+	public:
+		CProcess();
+		int Run(const string &command, const string &directory, function<void(const string &line)> output);
+		void Cancel();
+		void Reset();
+		bool IsCancelled();
+
+	private:
+		bool Launch(const string &command, const string &directory);
+		void Kill();
+
+	private:
+		mutex m_lock;
+		bool m_cancelled;
+#ifdef _WIN32
+		HANDLE m_job;
+		HANDLE m_process;
+		HANDLE m_output;
+#else
+		pid_t m_group;
+		int m_output;
+#endif
+	};
+}
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include "ResourceManager.h"
+
+namespace UltraEd
+{
+	CResourceManager::CResourceManager(CResourceAllocator *allocator)
+	{
+		m_allocator = allocator;
+		m_nextId = 1;
+		m_frame = 0;
+		m_budget = 128 * 1024 * 1024;
+		m_residentBytes = 0;
+	}
+
+	ResourceId CResourceManager::Add(size_t size, ResourcePriority::Value priority)
+	{
+		ResourceEntry entry = { size, priority, ResourceState::Unallocated, m_frame };
+		m_resources[m_nextId] = entry;
+		return m_nextId++;
+	}
+
+	void CResourceManager::Remove(ResourceId id)
+	{
+		auto resource = m_resources.find(id);
+		if (resource == m_resources.end()) return;
+
+		if (resource->second.state == ResourceState::Resident)
+		{
+			m_allocator->Free(id);
+			m_residentBytes -= resource->second.size;
+		}
+
+		m_resources.erase(resource);
+	}
+
+	bool CResourceManager::Use(ResourceId id)
+	{
+		auto resource = m_resources.find(id);
+		if (resource == m_resources.end()) return false;
+
+		ResourceEntry &entry = resource->second;
+		entry.lastUsedFrame = m_frame;
+
+		if (entry.state == ResourceState::Resident) return true;
+
+		if (!m_allocator->Allocate(id)) return false;
+
+		entry.state = ResourceState::Resident;
+		m_residentBytes += entry.size;
+		Evict();
+
+		return true;
+	}
+
+	void CResourceManager::SetPriority(ResourceId id, ResourcePriority::Value priority)
+	{
+		auto resource = m_resources.find(id);
+		if (resource != m_resources.end()) resource->second.priority = priority;
+	}
+
+	ResourceState::Value CResourceManager::GetState(ResourceId id)
+	{
+		auto resource = m_resources.find(id);
+		if (resource == m_resources.end()) return ResourceState::Unallocated;
+		return resource->second.state;
+	}
+
+	void CResourceManager::NextFrame()
+	{
+		m_frame++;
+	}
+
+	void CResourceManager::SetBudget(size_t bytes)
+	{
+		m_budget = bytes;
+		Evict();
+	}
+
+	void CResourceManager::Evict()
+	{
+		if (m_residentBytes <= m_budget) return;
+
+		// Resources used this frame are never evicted.
+		vector<ResourceId> candidates;
+		for (auto resource : m_resources)
+		{
+			if (resource.second.state == ResourceState::Resident && resource.second.lastUsedFrame != m_frame)
+			{
+				candidates.push_back(resource.first);
+			}
+		}
+
+		sort(candidates.begin(), candidates.end(), [this](ResourceId a, ResourceId b) {
+			ResourceEntry &first = m_resources[a];
+			ResourceEntry &second = m_resources[b];
+			if (first.lastUsedFrame != second.lastUsedFrame) return first.lastUsedFrame < second.lastUsedFrame;
+			if (first.priority != second.priority) return first.priority < second.priority;
+			return a < b;
+		});
+
+		for (auto id : candidates)
+		{
+			if (m_residentBytes <= m_budget) break;
+
+			ResourceEntry &entry = m_resources[id];
+			m_allocator->Free(id);
+			entry.state = ResourceState::Evicted;
+			m_residentBytes -= entry.size;
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <map>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef unsigned int ResourceId;
+
+	struct ResourcePriority
+	{
+		enum Value { Low, Normal, High };
+	};
+
+	struct ResourceState
+	{
+		enum Value { Unallocated, Resident, Evicted };
+	};
+
+	typedef struct
+	{
+		size_t size;
+		ResourcePriority::Value priority;
+		ResourceState::Value state;
+		unsigned int lastUsedFrame;
+	} ResourceEntry;
+
+	// Creates and destroys the actual resources on behalf of the manager
+	// so the residency bookkeeping can run without a device.
+	class CResourceAllocator
+	{
+	public:
+		virtual ~CResourceAllocator() {}
+		virtual bool Allocate(ResourceId id) = 0;
+		virtual void Free(ResourceId id) = 0;
+	};
+
+	class CResourceManager
+	{
+	public:
+		CResourceManager(CResourceAllocator *allocator);
+		ResourceId Add(size_t size, ResourcePriority::Value priority);
+		void Remove(ResourceId id);
+		bool Use(ResourceId id);
+		void SetPriority(ResourceId id, ResourcePriority::Value priority);
+		ResourceState::Value GetState(ResourceId id);
+		void NextFrame();
+		void SetBudget(size_t bytes);
+		size_t GetResidentBytes() { return m_residentBytes; }
+
+	private:
+		void Evict();
+
+	private:
+		CResourceAllocator *m_allocator;
+		map<ResourceId, ResourceEntry> m_resources;
+		ResourceId m_nextId;
+		unsigned int m_frame;
+		size_t m_budget;
+		size_t m_residentBytes;
+	};
+}
@@ -0,0 +1,89 @@
+#include <algorithm>
+#include "RomImage.h"
+
+namespace UltraEd
+{
+	// The boot code checksums the first megabyte following the header and IPL3.
+	const unsigned int checksumStart = 0x1000;
+	const unsigned int checksumLength = 0x100000;
+	const unsigned int checksumSeed = 0xF8CA4DDC;
+	const unsigned int crcOffset = 0x10;
+
+	// Cartridge sizes come in whole megabits.
+	const unsigned int romSizeStep = 0x20000;
+
+	CRomImage::CRomImage(const string &base)
+	{
+		m_data = base;
+	}
+
+	unsigned int CRomImage::AddSegment(const string &name, const string &data, unsigned int alignment)
+	{
+		size_t padding = (alignment - m_data.size() % alignment) % alignment;
+		m_data.append(padding, '\0');
+
+		RomSegment segment = { name, (unsigned int)m_data.size(), (unsigned int)data.size() };
+		m_segments.push_back(segment);
+		m_data.append(data);
+		return segment.offset;
+	}
+
+	void CRomImage::SetWord(unsigned int offset, unsigned int value)
+	{
+		if (m_data.size() < offset + 4) m_data.resize(offset + 4, '\0');
+
+		// Everything on the cartridge is big-endian.
+		for (int i = 0; i < 4; i++)
+		{
+			m_data[offset + i] = (char)(value >> (24 - i * 8));
+		}
+	}
+
+	bool CRomImage::Finalize()
+	{
+		if (m_data.size() < checksumStart) return false;
+
+		size_t size = max((size_t)checksumStart + checksumLength, m_data.size());
+		size = (size + romSizeStep - 1) / romSizeStep * romSizeStep;
+		m_data.resize(size, '\0');
+
+		unsigned int crc1, crc2;
+		if (!Checksum(m_data, &crc1, &crc2)) return false;
+
+		SetWord(crcOffset, crc1);
+		SetWord(crcOffset + 4, crc2);
+		return true;
+	}
+
+	bool CRomImage::Checksum(const string &rom, unsigned int *crc1, unsigned int *crc2)
+	{
+		if (rom.size() < checksumStart + checksumLength) return false;
+
+		unsigned int t1, t2, t3, t4, t5, t6;
+		t1 = t2 = t3 = t4 = t5 = t6 = checksumSeed;
+
+		for (size_t i = checksumStart; i < checksumStart + checksumLength; i += 4)
+		{
+			unsigned int d = ReadWord(rom, i);
+			if (t6 + d < t6) t4++;
+			t6 += d;
+			t3 ^= d;
+
+			unsigned int shift = d & 0x1F;
+			unsigned int r = shift == 0 ? d : (d << shift) | (d >> (32 - shift));
+			t5 += r;
+			t2 ^= t2 > d ? r : t6 ^ d;
+			t1 += t5 ^ d;
+		}
+
+		*crc1 = t6 ^ t4 ^ t3;
+		*crc2 = t5 ^ t2 ^ t1;
+		return true;
+	}
+
+	unsigned int CRomImage::ReadWord(const string &data, size_t offset)
+	{
+		const unsigned char *bytes = (const unsigned char*)data.data() + offset;
+		return (bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+	}
+}
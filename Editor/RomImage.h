@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		string name;
+		unsigned int offset;
+		unsigned int size;
+	} RomSegment;
+
+	// Lays segments out after a ROM holding the header, boot code and code segment,
+	// then pads it and writes the CIC-6102 boot checksum into the header.
+	class CRomImage
+	{
+	public:
+		CRomImage(const string &base);
+		unsigned int AddSegment(const string &name, const string &data, unsigned int alignment = 16);
+		void SetWord(unsigned int offset, unsigned int value);
+		bool Finalize();
+		const string &GetData() { return m_data; }
+		const vector<RomSegment> &GetSegments() { return m_segments; }
+		static bool Checksum(const string &rom, unsigned int *crc1, unsigned int *crc2);
+
+	private:
+		static unsigned int ReadWord(const string &data, size_t offset);
+
+	private:
+		string m_data;
+		vector<RomSegment> m_segments;
+	};
+}
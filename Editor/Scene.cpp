@@ -12,6 +12,7 @@ namespace UltraEd
 		ZeroMemory(&m_d3dpp, sizeof(m_d3dpp));
 		m_d3d8 = 0;
 		m_device = 0;
+		m_stack = 0;
 		m_fillMode = D3DFILL_SOLID;
 
 		ZeroMemory(&m_defaultMaterial, sizeof(D3DMATERIAL8));
@@ -36,7 +37,9 @@ namespace UltraEd
 
 	CScene::~CScene()
 	{
+		m_undo.Clear();
 		ReleaseResources(ModelRelease::AllResources);
+		if (m_stack) m_stack->Release();
 		if (m_device) m_device->Release();
 		if (m_d3d8) m_d3d8->Release();
 	}
@@ -66,6 +69,37 @@ namespace UltraEd
 			return false;
 		}
 
+		if (FAILED(D3DXCreateMatrixStack(0, &m_stack)))
+		{
+			return false;
+		}
+
+		// Wake the message loop when the background build has news.
+		m_builds.SetNotify([windowHandle] { PostMessage(windowHandle, WM_BUILD_PROGRESS, 0, 0); });
+
+		// Keep actor geometry within half of the reported video memory.
+		CVertexBufferPool::Instance().SetBudget(m_device->GetAvailableTextureMem() / 2);
+
+		string throttle;
+		if (CSettings::Get("IdleThrottle", throttle))
+		{
+			m_scheduler.SetIdleThrottle(throttle != "0");
+		}
+
+		// Imported geometry is quantized unless turned off.
+		string compactGeometry;
+		if (CSettings::Get("CompactGeometry", compactGeometry))
+		{
+			CActor::SetCompactGeometry(compactGeometry != "0");
+		}
+
+		// Undo memory is configured in megabytes.
+		string undoMemory;
+		if (CSettings::Get("UndoMemory", undoMemory))
+		{
+			m_undo.SetBudget((size_t)atoi(undoMemory.c_str()) * 1024 * 1024);
+		}
+
 		// Setup the new scene.
 		OnNew();
 		Resize();
@@ -77,9 +111,12 @@ namespace UltraEd
 	{
 		SetTitle("New");
 		selectedActorIds.clear();
+		m_transformStart.clear();
+		m_undo.Clear();
 		ReleaseResources(ModelRelease::AllResources);
 		m_actors.clear();
 		ResetViews();
+		Invalidate();
 	}
 
 	void CScene::OnSave()
@@ -161,6 +198,8 @@ namespace UltraEd
 			char buffer[1024];
 			sprintf(buffer, "Actor %d", m_actors.size());
 			m_actors[model->GetId()]->SetName(string(buffer));
+			JournalCreate({ model }, true);
+			Invalidate();
 		}
 	}
 
@@ -174,27 +213,11 @@ namespace UltraEd
 			actors.push_back(actor.second.get());
 		}
 
-		if (CBuild::Start(actors))
+		// The job holds a snapshot of the scene so editing can continue while it builds.
+		BuildJob job;
+		if (CBuild::Prepare(actors, flag, &job))
 		{
-			if (flag & BuildFlag::Run)
-			{
-				CBuild::Run();
-			}
-			else if (flag & BuildFlag::Load)
-			{
-				if (CBuild::Load())
-				{
-					MessageBox(NULL, "The ROM has been successfully loaded to the cart!", "Success", MB_OK);
-				}
-				else
-				{
-					MessageBox(NULL, "Could not load ROM onto cart. Make sure your cart is connected via USB.", "Error", MB_OK);
-				}
-			}
-			else
-			{
-				MessageBox(NULL, "The ROM has been successfully built!", "Success", MB_OK);
-			}
+			m_builds.Submit(job);
 		}
 		else
 		{
@@ -202,6 +225,34 @@ namespace UltraEd
 		}
 	}
 
+	void CScene::OnCancelBuild()
+	{
+		m_builds.Cancel();
+	}
+
+	void CScene::OnEstimateFrameCost()
+	{
+		vector<CActor*> actors;
+		for (auto actor : m_actors)
+		{
+			actors.push_back(actor.second.get());
+		}
+
+		string summary;
+		for (auto &line : CBuild::EstimateFrameCost(actors))
+		{
+			CDebug::Log("%.240s\n", line.c_str());
+			summary.append(line).append("\n");
+		}
+
+		MessageBox(NULL, summary.c_str(), "Frame Cost", MB_OK);
+	}
+
+	bool CScene::PollBuild(BuildEvent *event)
+	{
+		return m_builds.Poll(event);
+	}
+
 	void CScene::OnApplyTexture()
 	{
 		string file;
@@ -212,6 +263,14 @@ namespace UltraEd
 			return;
 		}
 
+		// Textures are shared with the journal by reference rather than copied.
+		auto share = [](LPDIRECT3DTEXTURE8 texture) {
+			if (texture != NULL) texture->AddRef();
+			return shared_ptr<IDirect3DTexture8>(texture, [](IDirect3DTexture8 *texture) {
+				if (texture != NULL) texture->Release();
+			});
+		};
+
 		for (auto selectedActorId : selectedActorIds)
 		{
 			if (CDialog::Open("Select a texture",
@@ -219,12 +278,31 @@ namespace UltraEd
 				"*.jpg\0BMP (*.bmp)\0*.bmp\0TGA (*.tga)\0*.tga", file))
 			{
 				if (m_actors[selectedActorId]->GetType() != ActorType::Model) continue;
-				if (!dynamic_cast<CModel*>(m_actors[selectedActorId].get())->LoadTexture(m_device, file.c_str()))
+				CModel *model = dynamic_cast<CModel*>(m_actors[selectedActorId].get());
+				auto before = share(model->GetTexture());
+				string beforePath = model->GetResources()["textureDataPath"];
+
+				if (!model->LoadTexture(m_device, file.c_str()))
 				{
 					MessageBox(NULL, "Texture could not be loaded.", "Error", MB_OK);
+					continue;
 				}
+
+				auto after = share(model->GetTexture());
+				string afterPath = model->GetResources()["textureDataPath"];
+
+				UndoStep step = { "", beforePath.size() + afterPath.size() + sizeof(GUID) };
+				step.undo = [this, selectedActorId, before, beforePath]() {
+					if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetTexture(before.get(), beforePath);
+				};
+				step.redo = [this, selectedActorId, after, afterPath]() {
+					if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetTexture(after.get(), afterPath);
+				};
+				m_undo.Push(step);
 			}
 		}
+
+		Invalidate();
 	}
 
 	bool CScene::Pick(POINT mousePoint)
@@ -234,6 +312,9 @@ namespace UltraEd
 		bool gizmoSelected = m_gizmo.Select(orig, dir);
 		float closestDist = FLT_MAX;
 
+		// Selection highlights change with every pick.
+		Invalidate();
+
 		// When just selecting the gizmo don't check any actors.
 		if (gizmoSelected) return true;
 
@@ -277,9 +358,12 @@ namespace UltraEd
 	{
 		if (m_device)
 		{
-			ReleaseResources(ModelRelease::VertexBufferOnly);
+			// Actor buffers are managed so they survive the reset without being re-uploaded.
+			m_grid.Release();
+			CDebug::Instance().Release();
 			m_device->Reset(&m_d3dpp);
 			UpdateViewMatrix();
+			Invalidate();
 		}
 	}
 
@@ -305,19 +389,45 @@ namespace UltraEd
 		m_device->SetTransform(D3DTS_PROJECTION, &viewMat);
 	}
 
-	void CScene::Render()
+	DWORD CScene::Tick()
+	{
+		// Keep frames coming while the view is flown or the gizmo dragged.
+		m_scheduler.SetContinuous(IsInteracting());
+
+		DWORD time = timeGetTime();
+		if (m_scheduler.IsFrameDue(time))
+		{
+			Render(m_scheduler.BeginFrame(time));
+		}
+
+		return m_scheduler.TimeUntilFrame(timeGetTime());
+	}
+
+	void CScene::Invalidate()
+	{
+		m_scheduler.Invalidate();
+	}
+
+	void CScene::SetBackground(bool background)
 	{
-		// Calculate the frame rendering speed.
-		static float lastTime = (float)timeGetTime();
-		float currentTime = (float)timeGetTime();
-		float deltaTime = (currentTime - lastTime) * 0.001f;
+		m_scheduler.SetBackground(background);
+	}
+
+	bool CScene::IsInteracting()
+	{
+		if (GetActiveWindow() != GetParent(GetWndHandle())) return false;
+
+		return ((GetAsyncKeyState(VK_LBUTTON) | GetAsyncKeyState(VK_RBUTTON) |
+			GetAsyncKeyState(VK_MBUTTON)) & 0x8000) != 0;
+	}
 
+	void CScene::Render(float deltaTime)
+	{
 		CheckInput(deltaTime);
 
-		if (m_device)
+		if (m_device && m_stack)
 		{
-			ID3DXMatrixStack *stack;
-			if (!SUCCEEDED(D3DXCreateMatrixStack(0, &stack))) return;
+			ID3DXMatrixStack *stack = m_stack;
 			stack->LoadMatrix(&GetActiveView()->GetViewMatrix());
 
 			m_device->SetTransform(D3DTS_WORLD, stack->GetTop());
@@ -330,6 +440,9 @@ namespace UltraEd
 			m_grid.Render(m_device);
 			CDebug::Instance().Render(m_device);
 
+			// Timed debug lines need further frames to expire.
+			if (CDebug::Instance().IsAnimating()) Invalidate();
+
 			// Render all actors with selected fill mode.
 			m_device->SetMaterial(&m_defaultMaterial);
 			m_device->SetRenderState(D3DRS_ZENABLE, TRUE);
@@ -358,9 +471,8 @@ namespace UltraEd
 
 			m_device->EndScene();
 			m_device->Present(NULL, NULL, NULL, NULL);
+			CVertexBufferPool::Instance().NextFrame();
 		}
-
-		lastTime = currentTime;
 	}
 
 	void CScene::CheckInput(float deltaTime)
@@ -374,13 +486,24 @@ namespace UltraEd
 		const float smoothingModifier = 16.0f;
 		const float mouseSpeedModifier = 0.55f;
 
-		if (GetActiveWindow() != GetParent(GetWndHandle())) return;
+		// A drag cut short by the window losing focus is journaled as it stands.
+		if (GetActiveWindow() != GetParent(GetWndHandle()))
+		{
+			EndTransform();
+			return;
+		}
+
 		if (GetAsyncKeyState('1')) m_gizmo.SetModifier(Translate);
 		if (GetAsyncKeyState('2')) m_gizmo.SetModifier(Rotate);
 		if (GetAsyncKeyState('3')) m_gizmo.SetModifier(Scale);
 
+		// A drag is journaled once the button is let go.
+		if (!GetAsyncKeyState(VK_LBUTTON)) EndTransform();
+
 		if (GetAsyncKeyState(VK_LBUTTON) && !selectedActorIds.empty())
 		{
+			if (m_transformStart.empty()) BeginTransform();
+
 			D3DXVECTOR3 rayOrigin, rayDir;
 			ScreenRaycast(mousePoint, &rayOrigin, &rayDir);
 			GUID lastSelectedActorId = selectedActorIds.back();
@@ -427,6 +550,7 @@ namespace UltraEd
 	{
 		GetActiveView()->Walk(zDelta * 0.005f);
 		UpdateViewMatrix();
+		Invalidate();
 	}
 
 	void CScene::ScreenRaycast(POINT screenPoint, D3DXVECTOR3 *origin, D3DXVECTOR3 *dir)
@@ -458,11 +582,13 @@ namespace UltraEd
 	{
 		m_activeViewType = type;
 		UpdateViewMatrix();
+		Invalidate();
 	}
 
 	void CScene::SetGizmoModifier(GizmoModifierState state)
 	{
 		m_gizmo.SetModifier(state);
+		Invalidate();
 	}
 
 	CView *CScene::GetActiveView()
@@ -474,6 +600,7 @@ namespace UltraEd
 	{
 		if (!selectedActorIds.empty())
 		{
+			Invalidate();
 			return m_gizmo.ToggleSpace(m_actors[selectedActorIds.back()].get());
 		}
 		return false;
@@ -481,6 +608,8 @@ namespace UltraEd
 
 	bool CScene::ToggleFillMode()
 	{
+		Invalidate();
+
 		if (m_fillMode == D3DFILL_SOLID)
 		{
 			m_fillMode = D3DFILL_WIREFRAME;
@@ -511,23 +640,20 @@ namespace UltraEd
 
 	void CScene::Delete()
 	{
+		vector<shared_ptr<CActor>> actors;
 		for (auto selectedActorId : selectedActorIds)
 		{
-			if (auto model = dynamic_cast<CModel*>(m_actors[selectedActorId].get()))
-			{
-				model->Release(ModelRelease::AllResources);
-			}
-			else
-			{
-				m_actors[selectedActorId]->Release();
-			}
-			m_actors.erase(selectedActorId);
+			actors.push_back(m_actors[selectedActorId]);
 		}
-		selectedActorIds.clear();
+
+		// The journal keeps deleted actors alive along with their textures.
+		RemoveActors(actors);
+		JournalCreate(actors, false);
 	}
 
 	void CScene::Duplicate()
 	{
+		vector<shared_ptr<CActor>> actors;
 		for (auto selectedActorId : selectedActorIds)
 		{
 			switch (m_actors[selectedActorId]->GetType())
@@ -537,25 +663,206 @@ namespace UltraEd
 					auto model = make_shared<CModel>(*dynamic_cast<CModel*>(m_actors[selectedActorId].get()));
 					string texturePath = model->GetResources()["textureDataPath"];
 					model->LoadTexture(m_device, texturePath.c_str());
-					m_actors[model->GetId()] = model;
+					actors.push_back(model);
 					break;
 				}
 				case ActorType::Camera:
 				{
 					auto camera = make_shared<CCamera>(*dynamic_cast<CCamera*>(m_actors[selectedActorId].get()));
-					m_actors[camera->GetId()] = camera;
+					actors.push_back(camera);
 					break;
 				}
 			}
 		}
+
+		AddActors(actors);
+		JournalCreate(actors, true);
+	}
+
+	void CScene::Undo()
+	{
+		EndTransform();
+		m_undo.Undo();
+		Invalidate();
+	}
+
+	void CScene::Redo()
+	{
+		EndTransform();
+		m_undo.Redo();
+		Invalidate();
+	}
+
+	CActor *CScene::FindActor(GUID id)
+	{
+		auto actor = m_actors.find(id);
+		return actor != m_actors.end() ? actor->second.get() : NULL;
+	}
+
+	void CScene::AddActors(const vector<shared_ptr<CActor>> &actors)
+	{
+		for (auto actor : actors)
+		{
+			m_actors[actor->GetId()] = actor;
+		}
+
+		Invalidate();
+	}
+
+	void CScene::RemoveActors(const vector<shared_ptr<CActor>> &actors)
+	{
+		for (auto actor : actors)
+		{
+			// Only the vertex buffer is released since the pool can rebuild it.
+			actor->Release();
+			m_actors.erase(actor->GetId());
+
+			auto selected = find(selectedActorIds.begin(), selectedActorIds.end(), actor->GetId());
+			if (selected != selectedActorIds.end()) selectedActorIds.erase(selected);
+		}
+
+		Invalidate();
+	}
+
+	void CScene::JournalCreate(const vector<shared_ptr<CActor>> &actors, bool created)
+	{
+		if (actors.empty()) return;
+
+		// Deleted actors are only kept alive by the step, along with their geometry and textures,
+		// while created ones are shared with the live scene.
+		UndoStep step = { "", actors.size() * sizeof(shared_ptr<CActor>) };
+		if (!created)
+		{
+			for (auto actor : actors) step.size += actor->GetMemoryBytes();
+		}
+		auto add = [this, actors]() { AddActors(actors); };
+		auto remove = [this, actors]() { RemoveActors(actors); };
+		step.undo = created ? remove : add;
+		step.redo = created ? add : remove;
+		m_undo.Push(step);
+	}
+
+	void CScene::BeginTransform()
+	{
+		for (auto selectedActorId : selectedActorIds)
+		{
+			m_transformStart[selectedActorId] = m_actors[selectedActorId]->GetTransform();
+		}
+	}
+
+	void CScene::EndTransform()
+	{
+		if (m_transformStart.empty()) return;
+
+		// Only the actors that actually moved are journaled.
+		vector<pair<GUID, ActorTransform>> before, after;
+		string key("transform");
+		for (auto start : m_transformStart)
+		{
+			CActor *actor = FindActor(start.first);
+			if (actor == NULL) continue;
+
+			ActorTransform current = actor->GetTransform();
+			if (memcmp(&current, &start.second, sizeof(ActorTransform)) == 0) continue;
+
+			before.push_back(start);
+			after.push_back(make_pair(start.first, current));
+			key.append(CUtil::GuidToString(start.first));
+		}
+
+		m_transformStart.clear();
+		if (before.empty()) return;
+
+		UndoStep step = { key, before.size() * 2 * sizeof(pair<GUID, ActorTransform>) };
+		auto apply = [this](const vector<pair<GUID, ActorTransform>> &transforms) {
+			for (auto transform : transforms)
+			{
+				if (CActor *actor = FindActor(transform.first)) actor->SetTransform(transform.second);
+			}
+		};
+		step.undo = [apply, before]() { apply(before); };
+		step.redo = [apply, after]() { apply(after); };
+		m_undo.Push(step);
 	}
 
 	void CScene::SetScript(string script)
 	{
 		if (!selectedActorIds.empty())
 		{
-			m_actors[selectedActorIds[0]]->SetScript(script);
+			GUID id = selectedActorIds[0];
+			string before = m_actors[id]->GetScript();
+			if (before == script) return;
+
+			m_actors[id]->SetScript(script);
+
+			UndoStep step = { "", before.size() + script.size() + sizeof(GUID) };
+			step.undo = [this, id, before]() { if (CActor *actor = FindActor(id)) actor->SetScript(before); };
+			step.redo = [this, id, script]() { if (CActor *actor = FindActor(id)) actor->SetScript(script); };
+			m_undo.Push(step);
+		}
+	}
+
+	void CScene::SetTextureAddress(TextureAddress::Value address)
+	{
+		for (auto selectedActorId : selectedActorIds)
+		{
+			CModel *model = dynamic_cast<CModel*>(m_actors[selectedActorId].get());
+			if (model == NULL) continue;
+
+			TextureAddress::Value before = model->GetTextureAddress();
+			if (before == address) continue;
+			model->SetTextureAddress(address);
+
+			UndoStep step = { "", sizeof(GUID) };
+			step.undo = [this, selectedActorId, before]() {
+				if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetTextureAddress(before);
+			};
+			step.redo = [this, selectedActorId, address]() {
+				if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetTextureAddress(address);
+			};
+			m_undo.Push(step);
 		}
+
+		Invalidate();
+	}
+
+	TextureAddress::Value CScene::GetTextureAddress()
+	{
+		if (!selectedActorIds.empty())
+		{
+			if (CModel *model = dynamic_cast<CModel*>(m_actors[selectedActorIds[0]].get())) return model->GetTextureAddress();
+		}
+		return TextureAddress::Wrap;
+	}
+
+	void CScene::SetStatic(bool isStatic)
+	{
+		for (auto selectedActorId : selectedActorIds)
+		{
+			CModel *model = dynamic_cast<CModel*>(m_actors[selectedActorId].get());
+			if (model == NULL || model->IsStatic() == isStatic) continue;
+			model->SetStatic(isStatic);
+
+			UndoStep step = { "", sizeof(GUID) };
+			step.undo = [this, selectedActorId, isStatic]() {
+				if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetStatic(!isStatic);
+			};
+			step.redo = [this, selectedActorId, isStatic]() {
+				if (auto model = dynamic_cast<CModel*>(FindActor(selectedActorId))) model->SetStatic(isStatic);
+			};
+			m_undo.Push(step);
+		}
+
+		Invalidate();
+	}
+
+	bool CScene::GetStatic()
+	{
+		if (!selectedActorIds.empty())
+		{
+			if (CModel *model = dynamic_cast<CModel*>(m_actors[selectedActorIds[0]].get())) return model->IsStatic();
+		}
+		return false;
 	}
 
 	string CScene::GetScript()
@@ -630,5 +937,7 @@ namespace UltraEd
 		m_actors[newCamera->GetId()] = newCamera;
 		sprintf(buffer, "Camera %d", m_actors.size());
 		m_actors[newCamera->GetId()]->SetName(string(buffer));
+		JournalCreate({ newCamera }, true);
+		Invalidate();
 	}
 }
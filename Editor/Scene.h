@@ -11,14 +11,12 @@
 #include "Grid.h"
 #include "Model.h"
 #include "Camera.h"
+#include "FrameScheduler.h"
+#include "Undo.h"
+#include "Build.h"
 
 namespace UltraEd
 {
-	struct BuildFlag
-	{
-		enum Value { _, Run, Load };
-	};
-
 	class CScene
 	{
 	public:
@@ -27,9 +25,18 @@ namespace UltraEd
 		bool Create(HWND windowHandle);
 		void Delete();
 		void Duplicate();
+		void Undo();
+		void Redo();
 		void SetScript(string script);
 		string GetScript();
-		void Render();
+		void SetTextureAddress(TextureAddress::Value address);
+		TextureAddress::Value GetTextureAddress();
+		void SetStatic(bool isStatic);
+		bool GetStatic();
+		DWORD Tick();
+		void Invalidate();
+		void SetBackground(bool background);
+		void Render(float deltaTime);
 		void Resize();
 		void OnMouseWheel(short zDelta);
 		void OnNew();
@@ -39,6 +46,9 @@ namespace UltraEd
 		void OnApplyTexture();
 		void OnImportModel();
 		void OnBuildROM(BuildFlag::Value flag);
+		void OnCancelBuild();
+		void OnEstimateFrameCost();
+		bool PollBuild(BuildEvent *event);
 		bool Pick(POINT mousePoint);
 		void ReleaseResources(ModelRelease::Value type);
 		void CheckInput(float);
@@ -55,6 +65,13 @@ namespace UltraEd
 		void SetTitle(string title);
 		void UpdateViewMatrix();
 		void ResetViews();
+		bool IsInteracting();
+		CActor *FindActor(GUID id);
+		void AddActors(const vector<shared_ptr<CActor>> &actors);
+		void RemoveActors(const vector<shared_ptr<CActor>> &actors);
+		void JournalCreate(const vector<shared_ptr<CActor>> &actors, bool created);
+		void BeginTransform();
+		void EndTransform();
 
 	private:
 		D3DLIGHT8 m_worldLight;
@@ -65,6 +82,11 @@ namespace UltraEd
 		CView m_views[4];
 		IDirect3DDevice8 *m_device;
 		IDirect3D8 *m_d3d8;
+		ID3DXMatrixStack *m_stack;
+		CFrameScheduler m_scheduler;
+		CUndo m_undo;
+		CBuildQueue m_builds;
+		map<GUID, ActorTransform> m_transformStart;
 		D3DPRESENT_PARAMETERS m_d3dpp;
 		map<GUID, shared_ptr<CActor>> m_actors;
 		CGrid m_grid;
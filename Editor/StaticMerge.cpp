@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include "CompactVertices.h"
+#include "StaticMerge.h"
+
+namespace UltraEd
+{
+	bool CStaticMerge::Merge(vector<BuildActor> &actors, int cellTriangles)
+	{
+		// Models sharing how their texture is converted can share one mesh.
+		map<string, vector<size_t>> groups;
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			if (CanMerge(actors[i]) && !IsReferenced(actors[i].name, actors)) groups[GroupKey(actors[i])].push_back(i);
+		}
+		if (groups.empty()) return true;
+
+		vector<BuildActor> merged;
+		vector<bool> removed(actors.size(), false);
+		for (auto &group : groups)
+		{
+			const vector<size_t> &members = group.second;
+			vector<vector<float>> baked(members.size()), centers(members.size());
+			vector<int> triangles(members.size());
+			for (size_t i = 0; i < members.size(); i++)
+			{
+				const BuildActor &actor = actors[members[i]];
+				if (!actor.loadVertices || !actor.loadVertices(baked[i])) return false;
+				Bake(actor, baked[i]);
+				triangles[i] = (int)(baked[i].size() / vertexFloats / 3);
+
+				// Pieces are placed into cells by the middle of their bounds.
+				float low[3], high[3];
+				for (int axis = 0; axis < 3; axis++) low[axis] = high[axis] = baked[i].empty() ? 0 : baked[i][axis];
+				for (size_t v = 0; v + vertexFloats <= baked[i].size(); v += vertexFloats)
+				{
+					for (int axis = 0; axis < 3; axis++)
+					{
+						low[axis] = min(low[axis], baked[i][v + axis]);
+						high[axis] = max(high[axis], baked[i][v + axis]);
+					}
+				}
+				for (int axis = 0; axis < 3; axis++) centers[i].push_back((low[axis] + high[axis]) / 2);
+			}
+
+			vector<size_t> order(members.size());
+			for (size_t i = 0; i < order.size(); i++) order[i] = i;
+			vector<vector<size_t>> cells;
+			Split(order, centers, triangles, cellTriangles, &cells);
+
+			for (auto &cell : cells)
+			{
+				// The first piece lends its texture and where to write the mesh file, which is
+				// named after the cell since pieces aren't guaranteed to have unique mesh paths.
+				const BuildActor &first = actors[members[cell[0]]];
+				BuildActor target = first;
+				target.script.clear();
+				float identity[3] = { 1, 1, 1 };
+				memcpy(target.scale, identity, sizeof(identity));
+				target.position[0] = target.position[1] = target.position[2] = 0;
+				target.axis[0] = target.axis[1] = 0;
+				target.axis[2] = 1;
+				target.angle = 0;
+				char name[32];
+				sprintf(name, "static%d.rom.vtx", (int)merged.size());
+				target.meshPath = first.meshPath.substr(0, first.meshPath.find_last_of("/\\") + 1).append(name);
+
+				if (cell.size() > 1)
+				{
+					sprintf(name, "Static %d", (int)merged.size());
+					target.name = name;
+				}
+
+				auto vertices = make_shared<vector<float>>();
+				for (auto member : cell)
+				{
+					vertices->insert(vertices->end(), baked[member].begin(), baked[member].end());
+					removed[members[member]] = true;
+				}
+				target.loadVertices = [vertices](vector<float> &output) {
+					output = *vertices;
+					return true;
+				};
+				merged.push_back(target);
+			}
+		}
+
+		// Everything else keeps its order with the merged meshes drawn after it.
+		vector<BuildActor> kept;
+		for (size_t i = 0; i < actors.size(); i++)
+		{
+			if (!removed[i]) kept.push_back(actors[i]);
+		}
+		kept.insert(kept.end(), merged.begin(), merged.end());
+		actors.swap(kept);
+		return true;
+	}
+
+	bool CStaticMerge::CanMerge(const BuildActor &actor)
+	{
+		if (actor.type != ActorType::Model || !actor.isStatic) return false;
+
+		// A merged piece no longer exists at runtime so its script must not do anything,
+		// like the empty hooks every new actor starts with.
+		const string &script = actor.script;
+		int depth = 0;
+		for (size_t i = 0; i < script.size(); i++)
+		{
+			char c = script[i];
+			if (c == '/' && i + 1 < script.size() && (script[i + 1] == '/' || script[i + 1] == '*'))
+			{
+				bool line = script[i + 1] == '/';
+				size_t end = script.find(line ? "\n" : "*/", i + 2);
+				if (end == string::npos) break;
+				i = end + (line ? 0 : 1);
+			}
+			else if (c == '{' && depth == 0) depth++;
+			else if (c == '}' && depth > 0) depth--;
+			else if (depth > 0 && !isspace((unsigned char)c)) return false;
+		}
+		return true;
+	}
+
+	bool CStaticMerge::IsReferenced(const string &name, const vector<BuildActor> &actors)
+	{
+		// Scripts find actors by name, which a merged piece no longer answers to.
+		string literal = string("\"").append(name).append("\"");
+		for (auto &actor : actors)
+		{
+			if (actor.script.find(literal) != string::npos) return true;
+		}
+		return false;
+	}
+
+	void CStaticMerge::Bake(const BuildActor &actor, vector<float> &vertices)
+	{
+		for (size_t i = 0; i + vertexFloats <= vertices.size(); i += vertexFloats)
+		{
+			// Scaled, rotated and then moved like the matrices sos_draw would have loaded.
+			float *position = &vertices[i];
+			for (int axis = 0; axis < 3; axis++) position[axis] *= actor.scale[axis];
+			CBuildCore::Rotate(actor.axis, actor.angle, position);
+			for (int axis = 0; axis < 3; axis++) position[axis] += actor.position[axis];
+
+			// Normals take the inverse scale to stay perpendicular to stretched faces.
+			float *normal = &vertices[i + 3];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (actor.scale[axis] != 0) normal[axis] /= actor.scale[axis];
+			}
+			CBuildCore::Rotate(actor.axis, actor.angle, normal);
+			float length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			for (int axis = 0; axis < 3 && length > 0; axis++) normal[axis] /= length;
+		}
+	}
+
+	string CStaticMerge::GroupKey(const BuildActor &actor)
+	{
+		char options[64];
+		sprintf(options, "%d %d %d %d\n", (int)actor.textureOptions.format, (int)actor.textureOptions.dither,
+			(int)actor.textureOptions.address, (int)actor.textureOptions.mipFilter);
+		return string(options).append(actor.texturePath);
+	}
+
+	void CStaticMerge::Split(vector<size_t> members, const vector<vector<float>> &centers,
+		const vector<int> &triangles, int cellTriangles, vector<vector<size_t>> *cells)
+	{
+		int total = 0;
+		for (auto member : members) total += triangles[member];
+		if (total <= cellTriangles || members.size() == 1)
+		{
+			cells->push_back(members);
+			return;
+		}
+
+		// Halve the cell across its longest side at the middle piece.
+		int longest = 0;
+		float longestExtent = -1;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float low = centers[members[0]][axis], high = low;
+			for (auto member : members)
+			{
+				low = min(low, centers[member][axis]);
+				high = max(high, centers[member][axis]);
+			}
+			if (high - low > longestExtent)
+			{
+				longest = axis;
+				longestExtent = high - low;
+			}
+		}
+
+		size_t middle = members.size() / 2;
+		nth_element(members.begin(), members.begin() + middle, members.end(), [&centers, longest](size_t a, size_t b) {
+			return centers[a][longest] < centers[b][longest];
+		});
+		Split(vector<size_t>(members.begin(), members.begin() + middle), centers, triangles, cellTriangles, cells);
+		Split(vector<size_t>(members.begin() + middle, members.end()), centers, triangles, cellTriangles, cells);
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "BuildCore.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	// Replaces static models with meshes that have their transforms baked in, one
+	// for each texture and spatial cell, so level geometry is drawn with a handful
+	// of calls instead of one with its own matrices for every piece.
+	class CStaticMerge
+	{
+	public:
+		static bool Merge(vector<BuildActor> &actors, int cellTriangles = 4096);
+		static bool CanMerge(const BuildActor &actor);
+		static void Bake(const BuildActor &actor, vector<float> &vertices);
+
+	private:
+		CStaticMerge() {}
+		static string GroupKey(const BuildActor &actor);
+		static bool IsReferenced(const string &name, const vector<BuildActor> &actors);
+		static void Split(vector<size_t> members, const vector<vector<float>> &centers,
+			const vector<int> &triangles, int cellTriangles, vector<vector<size_t>> *cells);
+	};
+}
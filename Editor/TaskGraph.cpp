@@ -0,0 +1,100 @@
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include "TaskGraph.h"
+
+namespace UltraEd
+{
+	CTaskGraph::CTaskGraph() : m_invalidDependency(false)
+	{
+	}
+
+	TaskId CTaskGraph::Add(function<bool()> work, const vector<TaskId> &dependencies)
+	{
+		TaskId id = (TaskId)m_tasks.size();
+		Task task = { work, vector<TaskId>() };
+
+		// Depending on a task that doesn't exist yet would run this one before its input is ready.
+		for (auto dependency : dependencies)
+		{
+			if (dependency < id) task.dependencies.push_back(dependency);
+			else m_invalidDependency = true;
+		}
+
+		m_tasks.push_back(task);
+		return id;
+	}
+
+	bool CTaskGraph::Run(unsigned int threadCount)
+	{
+		if (m_invalidDependency) return false;
+
+		if (threadCount == 0) threadCount = max(1u, thread::hardware_concurrency());
+		threadCount = min(threadCount, max(1u, (unsigned int)m_tasks.size()));
+
+		vector<vector<TaskId>> dependents(m_tasks.size());
+		vector<size_t> pending(m_tasks.size());
+		vector<bool> skipped(m_tasks.size(), false);
+		queue<TaskId> ready;
+
+		for (TaskId id = 0; id < m_tasks.size(); id++)
+		{
+			pending[id] = m_tasks[id].dependencies.size();
+			for (auto dependency : m_tasks[id].dependencies) dependents[dependency].push_back(id);
+			if (pending[id] == 0) ready.push(id);
+		}
+
+		mutex lock;
+		condition_variable changed;
+		size_t remaining = m_tasks.size();
+		bool succeeded = true;
+
+		auto worker = [&]() {
+			unique_lock<mutex> guard(lock);
+			while (true)
+			{
+				changed.wait(guard, [&] { return !ready.empty() || remaining == 0; });
+				if (remaining == 0) return;
+
+				TaskId id = ready.front();
+				ready.pop();
+
+				// Tasks after a failed dependency are skipped rather than run.
+				bool result = false;
+				if (!skipped[id])
+				{
+					guard.unlock();
+					result = m_tasks[id].work();
+					guard.lock();
+				}
+
+				if (!result) succeeded = false;
+
+				for (auto dependent : dependents[id])
+				{
+					if (!result) skipped[dependent] = true;
+					if (--pending[dependent] == 0) ready.push(dependent);
+				}
+
+				remaining--;
+				changed.notify_all();
+			}
+		};
+
+		// The calling thread takes part instead of idling until the pool finishes.
+		vector<thread> threads;
+		for (unsigned int i = 1; i < threadCount; i++) threads.push_back(thread(worker));
+		worker();
+		for (auto &thread : threads) thread.join();
+
+		return succeeded;
+	}
+
+	void CTaskGraph::Clear()
+	{
+		m_tasks.clear();
+		m_invalidDependency = false;
+	}
+}
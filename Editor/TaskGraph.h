@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef unsigned int TaskId;
+
+	typedef struct
+	{
+		function<bool()> work;
+		vector<TaskId> dependencies;
+	} Task;
+
+	// Runs tasks across a pool of threads with each task starting once all of the
+	// tasks it depends on have finished. Tasks can only depend on tasks added before
+	// them so the graph can never contain a cycle, and a graph given any other
+	// dependency fails to run. Tasks write their results into their own slots which
+	// keeps the output the same regardless of scheduling.
+	class CTaskGraph
+	{
+	public:
+		CTaskGraph();
+		TaskId Add(function<bool()> work, const vector<TaskId> &dependencies = vector<TaskId>());
+		bool Run(unsigned int threadCount = 0);
+		void Clear();
+		size_t GetCount() { return m_tasks.size(); }
+
+	private:
+		vector<Task> m_tasks;
+		bool m_invalidDependency;
+	};
+}
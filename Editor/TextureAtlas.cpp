@@ -0,0 +1,272 @@
+#include <algorithm>
+#include "TextureAtlas.h"
+
+namespace UltraEd
+{
+	// Matches struct sos_texture_header in the engine.
+	const size_t headerBytes = 16;
+	const unsigned char addressClamp = 2;
+
+	// Colour indexed atlases leave the upper half of TMEM to their palette.
+	const size_t tmemBytes = 4096;
+
+	// Texels copied from each edge so filtering never reaches a neighbour.
+	const int border = 1;
+
+	// Textures taking more than a quarter of an atlas are left to load on their own.
+	const int maxShare = 4;
+
+	CSkylinePacker::CSkylinePacker(int width, int height)
+	{
+		m_width = width;
+		m_height = height;
+		SkylineNode floor = { 0, 0, width };
+		m_skyline.push_back(floor);
+	}
+
+	bool CSkylinePacker::Insert(int width, int height, AtlasRect *rect)
+	{
+		// Prefer the spot that leaves the lowest top edge, then the narrowest step.
+		int bestIndex = -1, bestTop = m_height + 1, bestWidth = m_width + 1;
+		for (size_t i = 0; i < m_skyline.size(); i++)
+		{
+			int y = Fit(i, width, height);
+			if (y < 0) continue;
+
+			if (y + height < bestTop || (y + height == bestTop && m_skyline[i].width < bestWidth))
+			{
+				bestIndex = (int)i;
+				bestTop = y + height;
+				bestWidth = m_skyline[i].width;
+			}
+		}
+		if (bestIndex < 0) return false;
+
+		AtlasRect placed = { m_skyline[bestIndex].x, bestTop - height, width, height };
+		*rect = placed;
+
+		// The new top edge covers the steps it was placed over.
+		SkylineNode node = { placed.x, bestTop, width };
+		m_skyline.insert(m_skyline.begin() + bestIndex, node);
+		for (size_t i = bestIndex + 1; i < m_skyline.size();)
+		{
+			int overlap = m_skyline[i - 1].x + m_skyline[i - 1].width - m_skyline[i].x;
+			if (overlap <= 0) break;
+
+			if (overlap < m_skyline[i].width)
+			{
+				m_skyline[i].x += overlap;
+				m_skyline[i].width -= overlap;
+				break;
+			}
+			m_skyline.erase(m_skyline.begin() + i);
+		}
+
+		// Neighbouring steps of the same height become one.
+		for (size_t i = 1; i < m_skyline.size();)
+		{
+			if (m_skyline[i - 1].y == m_skyline[i].y)
+			{
+				m_skyline[i - 1].width += m_skyline[i].width;
+				m_skyline.erase(m_skyline.begin() + i);
+			}
+			else i++;
+		}
+		return true;
+	}
+
+	int CSkylinePacker::Fit(size_t index, int width, int height)
+	{
+		if (m_skyline[index].x + width > m_width) return -1;
+
+		// Rests on the highest step under its whole width.
+		int y = 0, remaining = width;
+		for (size_t i = index; remaining > 0 && i < m_skyline.size(); i++)
+		{
+			y = max(y, m_skyline[i].y);
+			if (y + height > m_height) return -1;
+			remaining -= m_skyline[i].width;
+		}
+		return y;
+	}
+
+	bool CTextureAtlas::IsCandidate(const string &texture)
+	{
+		if (texture.size() < headerBytes) return false;
+
+		int width = Width(texture), height = Height(texture);
+		if (width < 2 || height < 1) return false;
+
+		int atlasWidth, atlasHeight;
+		AtlasSize(texture, &atlasWidth, &atlasHeight);
+		int paddedWidth = width + border * 2, paddedHeight = height + border * 2;
+		return paddedWidth <= atlasWidth && paddedHeight <= atlasHeight
+			&& paddedWidth * paddedHeight * maxShare <= atlasWidth * atlasHeight;
+	}
+
+	vector<TextureAtlas> CTextureAtlas::Pack(const vector<string> &textures)
+	{
+		vector<size_t> order;
+		for (size_t i = 0; i < textures.size(); i++)
+		{
+			if (IsCandidate(textures[i])) order.push_back(i);
+		}
+
+		// Tallest first keeps the skyline flat so less of each atlas is wasted.
+		stable_sort(order.begin(), order.end(), [&textures](size_t a, size_t b) {
+			if (Height(textures[a]) != Height(textures[b])) return Height(textures[a]) > Height(textures[b]);
+			return Width(textures[a]) > Width(textures[b]);
+		});
+
+		vector<TextureAtlas> atlases;
+		vector<CSkylinePacker> packers;
+		for (auto index : order)
+		{
+			const string &texture = textures[index];
+			int paddedWidth = Width(texture) + border * 2, paddedHeight = Height(texture) + border * 2;
+
+			AtlasRect rect;
+			size_t atlas = 0;
+			while (atlas < atlases.size())
+			{
+				if (Compatible(textures[atlases[atlas].members[0]], texture)
+					&& packers[atlas].Insert(paddedWidth, paddedHeight, &rect)) break;
+				atlas++;
+			}
+
+			if (atlas == atlases.size())
+			{
+				int atlasWidth, atlasHeight;
+				AtlasSize(texture, &atlasWidth, &atlasHeight);
+				packers.push_back(CSkylinePacker(atlasWidth, atlasHeight));
+				packers.back().Insert(paddedWidth, paddedHeight, &rect);
+				atlases.push_back(TextureAtlas());
+			}
+
+			AtlasRect region = { rect.x + border, rect.y + border, Width(texture), Height(texture) };
+			atlases[atlas].members.push_back(index);
+			atlases[atlas].regions.push_back(region);
+		}
+
+		// An atlas holding one texture would only cost it its mip levels.
+		vector<TextureAtlas> packed;
+		for (auto &atlas : atlases)
+		{
+			if (atlas.members.size() < 2) continue;
+
+			int width, height;
+			AtlasSize(textures[atlas.members[0]], &width, &height);
+			atlas.texture = Compose(textures, atlas, width, height);
+			packed.push_back(atlas);
+		}
+		return packed;
+	}
+
+	bool CTextureAtlas::Compatible(const string &a, const string &b)
+	{
+		// Format, size and palette entries must match and so must the palettes themselves.
+		if (a.compare(4, 2, b, 4, 2) != 0 || a.compare(8, 2, b, 8, 2) != 0) return false;
+
+		size_t paletteBytes = PaletteBytes(a);
+		return a.compare(a.size() - paletteBytes, paletteBytes, b, b.size() - paletteBytes, paletteBytes) == 0;
+	}
+
+	void CTextureAtlas::AtlasSize(const string &texture, int *width, int *height)
+	{
+		// The largest power of two, as square as possible, that fits TMEM.
+		size_t bytes = PaletteBytes(texture) > 0 ? tmemBytes / 2 : tmemBytes;
+		size_t texels = bytes * 8 / Bits(texture);
+		*width = *height = 1;
+		while ((size_t)*width * *height * 2 <= texels)
+		{
+			if (*width <= *height) *width *= 2;
+			else *height *= 2;
+		}
+	}
+
+	string CTextureAtlas::Compose(const vector<string> &textures, const TextureAtlas &atlas, int width, int height)
+	{
+		const string &first = textures[atlas.members[0]];
+		int bits = Bits(first);
+		size_t texelBytes = (size_t)width * height * bits / 8;
+		string texels(texelBytes, '\0');
+
+		// Every member's first level is copied in along with a border repeating its edges.
+		for (size_t i = 0; i < atlas.members.size(); i++)
+		{
+			const string &texture = textures[atlas.members[i]];
+			const AtlasRect &region = atlas.regions[i];
+			for (int y = region.y - border; y < region.y + region.height + border; y++)
+			{
+				for (int x = region.x - border; x < region.x + region.width + border; x++)
+				{
+					int sourceX = min(max(x - region.x, 0), region.width - 1);
+					int sourceY = min(max(y - region.y, 0), region.height - 1);
+					unsigned int texel = ReadTexel(texture, headerBytes, bits, (size_t)sourceY * region.width + sourceX);
+					WriteTexel(texels, 0, bits, (size_t)y * width + x, texel);
+				}
+			}
+		}
+
+		// The first member's header describes the rest once the size, levels and addressing change.
+		string atlasTexture = first.substr(0, headerBytes);
+		atlasTexture[0] = (char)(width >> 8);
+		atlasTexture[1] = (char)width;
+		atlasTexture[2] = (char)(height >> 8);
+		atlasTexture[3] = (char)height;
+		atlasTexture[6] = 1;
+		atlasTexture[7] = (char)addressClamp;
+		atlasTexture[12] = (char)(texelBytes >> 8);
+		atlasTexture[13] = (char)texelBytes;
+		atlasTexture.append(texels);
+		return atlasTexture.append(first.substr(first.size() - PaletteBytes(first)));
+	}
+
+	int CTextureAtlas::Width(const string &texture)
+	{
+		return (unsigned char)texture[0] << 8 | (unsigned char)texture[1];
+	}
+
+	int CTextureAtlas::Height(const string &texture)
+	{
+		return (unsigned char)texture[2] << 8 | (unsigned char)texture[3];
+	}
+
+	int CTextureAtlas::Bits(const string &texture)
+	{
+		return 4 << (unsigned char)texture[5];
+	}
+
+	int CTextureAtlas::PaletteBytes(const string &texture)
+	{
+		return ((unsigned char)texture[8] << 8 | (unsigned char)texture[9]) * 2;
+	}
+
+	unsigned int CTextureAtlas::ReadTexel(const string &data, size_t start, int bits, size_t index)
+	{
+		if (bits == 4)
+		{
+			unsigned char pair = (unsigned char)data[start + index / 2];
+			return index % 2 == 0 ? pair >> 4 : pair & 15;
+		}
+
+		unsigned int texel = 0;
+		size_t bytes = bits / 8;
+		for (size_t i = 0; i < bytes; i++) texel = texel << 8 | (unsigned char)data[start + index * bytes + i];
+		return texel;
+	}
+
+	void CTextureAtlas::WriteTexel(string &data, size_t start, int bits, size_t index, unsigned int texel)
+	{
+		if (bits == 4)
+		{
+			// Two texels share a byte with the first in the high nibble.
+			char &pair = data[start + index / 2];
+			pair = index % 2 == 0 ? (char)((pair & 15) | texel << 4) : (char)((pair & 0xF0) | texel);
+			return;
+		}
+
+		size_t bytes = bits / 8;
+		for (size_t i = 0; i < bytes; i++) data[start + index * bytes + i] = (char)(texel >> (8 * (bytes - 1 - i)));
+	}
+}
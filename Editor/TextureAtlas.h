@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+	} AtlasRect;
+
+	// Places rectangles as low and as far left as they go along the outline of
+	// the ones placed before.
+	class CSkylinePacker
+	{
+	public:
+		CSkylinePacker(int width, int height);
+		bool Insert(int width, int height, AtlasRect *rect);
+
+	private:
+		typedef struct
+		{
+			int x;
+			int y;
+			int width;
+		} SkylineNode;
+
+		int Fit(size_t index, int width, int height);
+
+	private:
+		int m_width;
+		int m_height;
+		vector<SkylineNode> m_skyline;
+	};
+
+	typedef struct
+	{
+		string texture;            // Encoded like any other texture, with a single level.
+		vector<size_t> members;    // Indexes of the textures packed into it.
+		vector<AtlasRect> regions; // Where each member's texels landed.
+	} TextureAtlas;
+
+	// Packs small encoded textures of the same format and palette into atlases that
+	// fill TMEM so the models using them share a single load.
+	class CTextureAtlas
+	{
+	public:
+		static bool IsCandidate(const string &texture);
+		static vector<TextureAtlas> Pack(const vector<string> &textures);
+
+	private:
+		CTextureAtlas() {}
+		static bool Compatible(const string &a, const string &b);
+		static void AtlasSize(const string &texture, int *width, int *height);
+		static string Compose(const vector<string> &textures, const TextureAtlas &atlas, int width, int height);
+		static int Width(const string &texture);
+		static int Height(const string &texture);
+		static int Bits(const string &texture);
+		static int PaletteBytes(const string &texture);
+		static unsigned int ReadTexel(const string &data, size_t start, int bits, size_t index);
+		static void WriteTexel(string &data, size_t start, int bits, size_t index, unsigned int texel);
+	};
+}
@@ -0,0 +1,697 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include "TextureEncoder.h"
+
+namespace UltraEd
+{
+	// Values of G_IM_FMT_* and G_IM_SIZ_* from the GBI.
+	const unsigned char formatRGBA = 0;
+	const unsigned char formatCI = 2;
+	const unsigned char formatIA = 3;
+	const unsigned char formatI = 4;
+	const unsigned char size4b = 0;
+	const unsigned char size8b = 1;
+	const unsigned char size16b = 2;
+	const unsigned char size32b = 3;
+
+	// Matches struct sos_texture_header in the engine.
+	const size_t headerBytes = 16;
+
+	// TMEM holds 4 KB and eight tiles, one of which is kept for loading.
+	const size_t tmemBytes = 4096;
+	const int maxLevels = 7;
+	const int maxTextureSize = 1024;
+
+	// Mip levels filtered with a Kaiser window use eight taps per axis.
+	const int kaiserTaps = 8;
+	const float kaiserBeta = 4.0f;
+
+	// Mean Oklab distance a palette may move the colours, about one just noticeable difference.
+	const float paletteError = 0.02f;
+	const int kMeansRounds = 4;
+
+	// Thresholds of a 4x4 ordered dither which tiles cleanly on wrapping textures.
+	const int bayer[4][4] = {
+		{ 0, 8, 2, 10 },
+		{ 12, 4, 14, 6 },
+		{ 3, 11, 1, 9 },
+		{ 15, 7, 13, 5 }
+	};
+
+	string CTextureEncoder::Encode(const unsigned char *rgba, int width, int height, const TextureOptions &options)
+	{
+		vector<unsigned short> palette;
+		TextureFormat::Value format = ResolveFormat(rgba, width, height, options.format, &palette);
+		int levels = LevelCount(format, width, height, options.mipFilter);
+
+		// Each level is filtered from the one before and shares the first level's palette.
+		string texels = EncodeTexels(rgba, width, height, format, palette, options.dither);
+		vector<unsigned char> level(rgba, rgba + width * height * 4);
+		int levelWidth = width, levelHeight = height;
+		for (int i = 1; i < levels; i++)
+		{
+			level = Downsample(&level[0], levelWidth, levelHeight, options.mipFilter, options.address);
+			levelWidth = max(1, levelWidth / 2);
+			levelHeight = max(1, levelHeight / 2);
+			texels.append(EncodeTexels(&level[0], levelWidth, levelHeight, format, palette, options.dither));
+		}
+
+		unsigned char imageFormat = format == TextureFormat::IA8 || format == TextureFormat::IA16 ? formatIA :
+			format == TextureFormat::I4 || format == TextureFormat::I8 ? formatI :
+			format == TextureFormat::CI4 || format == TextureFormat::CI8 ? formatCI : formatRGBA;
+		int bits = TexelBits(format);
+		unsigned char imageSize = bits == 4 ? size4b : bits == 8 ? size8b : bits == 16 ? size16b : size32b;
+		unsigned int bytes = (unsigned int)texels.size();
+		unsigned int entries = (unsigned int)palette.size();
+
+		// Width, height, format, size, levels, address mode, palette entries, the palette's
+		// asset which is only known once the textures are packed and texel bytes, all big-endian.
+		unsigned char header[headerBytes] = {
+			(unsigned char)(width >> 8), (unsigned char)width, (unsigned char)(height >> 8), (unsigned char)height,
+			imageFormat, imageSize, (unsigned char)levels, (unsigned char)options.address,
+			(unsigned char)(entries >> 8), (unsigned char)entries, 0, 0,
+			(unsigned char)(bytes >> 8), (unsigned char)bytes, 0, 0
+		};
+
+		string encoded = string((const char*)header, headerBytes).append(texels);
+		for (auto entry : palette)
+		{
+			encoded.push_back((char)(entry >> 8));
+			encoded.push_back((char)entry);
+		}
+		return encoded;
+	}
+
+	TextureFormat::Value CTextureEncoder::ResolveFormat(const unsigned char *rgba, int width, int height,
+		TextureFormat::Value format, vector<unsigned short> *palette)
+	{
+		vector<unsigned short> unused;
+		if (palette == NULL) palette = &unused;
+		palette->clear();
+
+		int pixels = width * height;
+		if (format == TextureFormat::Auto)
+		{
+			format = SelectFormat(rgba, width, height);
+
+			// Colour images are indexed when a palette keeps them close to the original
+			// and the texels plus the palette still take less room than RGBA16.
+			if (format == TextureFormat::RGBA16)
+			{
+				if (pixels / 2 + 16 * 2 < pixels * 2 && BuildPalette(rgba, pixels, 16, palette) <= paletteError)
+					format = TextureFormat::CI4;
+				else if (pixels + 256 * 2 < pixels * 2 && BuildPalette(rgba, pixels, 256, palette) <= paletteError)
+					format = TextureFormat::CI8;
+				else
+					palette->clear();
+			}
+		}
+		else if (format == TextureFormat::CI4 || format == TextureFormat::CI8)
+		{
+			BuildPalette(rgba, pixels, format == TextureFormat::CI4 ? 16 : 256, palette);
+		}
+
+		return format;
+	}
+
+	string CTextureEncoder::EncodeTexels(const unsigned char *rgba, int width, int height, TextureFormat::Value format,
+		const vector<unsigned short> &palette, bool dither)
+	{
+		vector<unsigned char> indices;
+		if (!palette.empty())
+		{
+			vector<PaletteColor> colors;
+			for (int i = 0; i < width * height; i++) colors.push_back(ToColor(&rgba[i * 4]));
+			MapColors(colors, palette, width, dither, &indices);
+		}
+
+		string texels;
+		for (int y = 0; y < height; y++)
+		{
+			for (int x = 0; x < width; x++)
+			{
+				const unsigned char *pixel = &rgba[(y * width + x) * 4];
+				float threshold = dither ? (bayer[y % 4][x % 4] + 0.5f) / 16 : 0.5f;
+
+				switch (format)
+				{
+				case TextureFormat::RGBA32:
+					texels.append((const char*)pixel, 4);
+					break;
+				case TextureFormat::IA16:
+					texels.push_back((char)Intensity(pixel));
+					texels.push_back((char)pixel[3]);
+					break;
+				case TextureFormat::IA8:
+					texels.push_back((char)(Quantize(Intensity(pixel), 4, threshold) << 4 | Quantize(pixel[3], 4, threshold)));
+					break;
+				case TextureFormat::I8:
+					texels.push_back((char)Intensity(pixel));
+					break;
+				case TextureFormat::CI8:
+					texels.push_back((char)indices[y * width + x]);
+					break;
+				case TextureFormat::I4:
+				case TextureFormat::CI4:
+				{
+					// Two texels share a byte with the first in the high nibble.
+					unsigned int nibble = format == TextureFormat::CI4 ? indices[y * width + x] :
+						Quantize(Intensity(pixel), 4, threshold);
+					if (x % 2 == 0) texels.push_back((char)(nibble << 4));
+					else texels.back() = (char)(texels.back() | nibble);
+					break;
+				}
+				default:
+				{
+					unsigned int texel = Quantize(pixel[0], 5, threshold) << 11 | Quantize(pixel[1], 5, threshold) << 6
+						| Quantize(pixel[2], 5, threshold) << 1 | (pixel[3] >= 128 ? 1 : 0);
+					texels.push_back((char)(texel >> 8));
+					texels.push_back((char)texel);
+					break;
+				}
+				}
+			}
+		}
+
+		return texels;
+	}
+
+	TextureFormat::Value CTextureEncoder::SelectFormat(const unsigned char *rgba, int width, int height)
+	{
+		bool gray = true, translucent = false, partialAlpha = false, fourBit = true;
+		for (int i = 0; i < width * height; i++)
+		{
+			const unsigned char *pixel = &rgba[i * 4];
+			gray &= pixel[0] == pixel[1] && pixel[1] == pixel[2];
+			translucent |= pixel[3] != 255;
+			partialAlpha |= pixel[3] != 0 && pixel[3] != 255;
+
+			// Values that are multiples of 17 survive being stored in four bits.
+			fourBit &= pixel[0] % 17 == 0 && pixel[3] % 17 == 0;
+		}
+
+		// Prefer the smallest format that keeps the image as it is.
+		if (gray && !translucent) return fourBit ? TextureFormat::I4 : TextureFormat::I8;
+		if (gray) return fourBit ? TextureFormat::IA8 : TextureFormat::IA16;
+		return partialAlpha ? TextureFormat::RGBA32 : TextureFormat::RGBA16;
+	}
+
+	TextureFormat::Value CTextureEncoder::ParseFormat(const string &name)
+	{
+		string lower(name);
+		transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+		if (lower == "rgba16") return TextureFormat::RGBA16;
+		if (lower == "rgba32") return TextureFormat::RGBA32;
+		if (lower == "ia8") return TextureFormat::IA8;
+		if (lower == "ia16") return TextureFormat::IA16;
+		if (lower == "i4") return TextureFormat::I4;
+		if (lower == "i8") return TextureFormat::I8;
+		if (lower == "ci4") return TextureFormat::CI4;
+		if (lower == "ci8") return TextureFormat::CI8;
+		return TextureFormat::Auto;
+	}
+
+	int CTextureEncoder::TexelBits(TextureFormat::Value format)
+	{
+		switch (format)
+		{
+		case TextureFormat::RGBA32: return 32;
+		case TextureFormat::IA8: case TextureFormat::I8: case TextureFormat::CI8: return 8;
+		case TextureFormat::I4: case TextureFormat::CI4: return 4;
+		default: return 16;
+		}
+	}
+
+	MipFilter::Value CTextureEncoder::ParseMipFilter(const string &name)
+	{
+		string lower(name);
+		transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+		if (lower == "none") return MipFilter::None;
+		if (lower == "kaiser") return MipFilter::Kaiser;
+		return MipFilter::Box;
+	}
+
+	void CTextureEncoder::FitSize(int width, int height, int *fitWidth, int *fitHeight)
+	{
+		// Wrapping and mirroring mask the texture coordinates so sides are powers of two.
+		*fitWidth = *fitHeight = 1;
+		while (*fitWidth * 2 <= min(width, maxTextureSize)) *fitWidth *= 2;
+		while (*fitHeight * 2 <= min(height, maxTextureSize)) *fitHeight *= 2;
+	}
+
+	int CTextureEncoder::LevelCount(TextureFormat::Value format, int width, int height, MipFilter::Value filter)
+	{
+		// RGBA32 splits its texels across both halves of TMEM which leaves no room for a chain.
+		if (filter == MipFilter::None || format == TextureFormat::RGBA32) return 1;
+
+		// Levels stop once a row is smaller than the eight bytes a load works in.
+		int levels = 1, bits = TexelBits(format);
+		while (levels < maxLevels && width / 2 * bits >= 64 && height > 1)
+		{
+			width /= 2;
+			height /= 2;
+			levels++;
+		}
+		return levels;
+	}
+
+	size_t CTextureEncoder::TmemBytes(TextureFormat::Value format, int width, int height, int levels)
+	{
+		// Every row of every level starts on a new 64-bit TMEM word.
+		size_t bytes = 0;
+		for (int i = 0; i < levels; i++)
+		{
+			bytes += (width * TexelBits(format) + 63) / 64 * 8 * height;
+			width = max(1, width / 2);
+			height = max(1, height / 2);
+		}
+		return bytes;
+	}
+
+	bool CTextureEncoder::FitsTmem(TextureFormat::Value format, int width, int height, int levels)
+	{
+		// Palettes are loaded into the upper half of TMEM.
+		bool indexed = format == TextureFormat::CI4 || format == TextureFormat::CI8;
+		return TmemBytes(format, width, height, levels) <= (indexed ? tmemBytes / 2 : tmemBytes);
+	}
+
+	vector<unsigned char> CTextureEncoder::Downsample(const unsigned char *rgba, int width, int height,
+		MipFilter::Value filter, TextureAddress::Value address)
+	{
+		// Taps sit half a texel either side of the centres of each pair of source texels.
+		int taps = filter == MipFilter::Kaiser ? kaiserTaps : 2;
+		vector<float> weights(taps);
+		float total = 0;
+		for (int i = 0; i < taps; i++)
+		{
+			weights[i] = filter == MipFilter::Kaiser ? KaiserWeight(i - taps / 2 + 0.5f, taps / 2.0f) : 1;
+			total += weights[i];
+		}
+		for (auto &weight : weights) weight /= total;
+
+		// Each axis is halved in its own pass, skipping one that is a single texel already.
+		vector<float> source(rgba, rgba + width * height * 4);
+		for (int axis = 0; axis < 2; axis++)
+		{
+			int size = axis == 0 ? width : height;
+			if (size < 2) continue;
+
+			int targetWidth = axis == 0 ? width / 2 : width;
+			int targetHeight = axis == 0 ? height : height / 2;
+			vector<float> target(targetWidth * targetHeight * 4, 0);
+			for (int y = 0; y < targetHeight; y++)
+			{
+				for (int x = 0; x < targetWidth; x++)
+				{
+					int center = 2 * (axis == 0 ? x : y) - taps / 2 + 1;
+					for (int i = 0; i < taps; i++)
+					{
+						int texel = AddressTexel(center + i, size, address);
+						const float *pixel = &source[((axis == 0 ? y : texel) * width + (axis == 0 ? texel : x)) * 4];
+						for (int channel = 0; channel < 4; channel++)
+						{
+							target[(y * targetWidth + x) * 4 + channel] += weights[i] * pixel[channel];
+						}
+					}
+				}
+			}
+
+			source = target;
+			width = targetWidth;
+			height = targetHeight;
+		}
+
+		vector<unsigned char> result(source.size());
+		for (size_t i = 0; i < source.size(); i++)
+		{
+			result[i] = (unsigned char)min(255.0f, max(0.0f, floor(source[i] + 0.5f)));
+		}
+		return result;
+	}
+
+	int CTextureEncoder::PaletteEntries(const string &texture)
+	{
+		if (texture.size() < headerBytes) return 0;
+		return (unsigned char)texture[8] << 8 | (unsigned char)texture[9];
+	}
+
+	int CTextureEncoder::SharePalettes(vector<string> &textures)
+	{
+		vector<vector<unsigned short>> shared;
+		int remapped = 0;
+
+		for (auto &texture : textures)
+		{
+			int entries = PaletteEntries(texture);
+			if (entries == 0) continue;
+
+			const unsigned char *data = (const unsigned char*)texture.data();
+			int width = data[0] << 8 | data[1];
+			int height = data[2] << 8 | data[3];
+			bool fourBit = data[5] == size4b;
+			int levels = data[6];
+			size_t texelBytes = data[12] << 8 | data[13];
+			if (texture.size() < headerBytes + texelBytes + entries * 2) continue;
+
+			vector<unsigned short> palette;
+			for (int i = 0; i < entries; i++)
+			{
+				const unsigned char *entry = &data[headerBytes + texelBytes + i * 2];
+				palette.push_back((unsigned short)(entry[0] << 8 | entry[1]));
+			}
+
+			// Rows of four bit texels start on a new byte like the encoder writes them.
+			vector<PaletteColor> colors;
+			vector<int> columns;
+			size_t offset = headerBytes;
+			for (int level = 0, levelWidth = width, levelHeight = height; level < levels; level++)
+			{
+				size_t rowBytes = fourBit ? (levelWidth + 1) / 2 : levelWidth;
+				for (int y = 0; y < levelHeight; y++)
+				{
+					for (int x = 0; x < levelWidth; x++)
+					{
+						unsigned char texel = data[offset + y * rowBytes + (fourBit ? x / 2 : x)];
+						int index = fourBit ? (x % 2 == 0 ? texel >> 4 : texel & 0xF) : texel;
+						colors.push_back(ToColor(palette[index]));
+						columns.push_back(x);
+					}
+				}
+
+				offset += rowBytes * levelHeight;
+				levelWidth = max(1, levelWidth / 2);
+				levelHeight = max(1, levelHeight / 2);
+			}
+
+			// The texels already carry the error of their own palette so moving them to
+			// another one may only use up half of the budget.
+			bool moved = false;
+			for (auto &candidate : shared)
+			{
+				vector<unsigned char> indices;
+				if (candidate.size() != palette.size()
+					|| MapColors(colors, candidate, width, false, &indices) > paletteError / 2) continue;
+
+				string texels;
+				for (size_t i = 0; i < indices.size(); i++)
+				{
+					if (!fourBit) texels.push_back((char)indices[i]);
+					else if (columns[i] % 2 == 0) texels.push_back((char)(indices[i] << 4));
+					else texels.back() = (char)(texels.back() | indices[i]);
+				}
+
+				texture.replace(headerBytes, texelBytes, texels);
+				for (int i = 0; i < entries; i++)
+				{
+					texture[headerBytes + texelBytes + i * 2] = (char)(candidate[i] >> 8);
+					texture[headerBytes + texelBytes + i * 2 + 1] = (char)candidate[i];
+				}
+
+				moved = true;
+				remapped++;
+				break;
+			}
+
+			if (!moved) shared.push_back(palette);
+		}
+
+		return remapped;
+	}
+
+	unsigned int CTextureEncoder::Quantize(unsigned char value, int bits, float threshold)
+	{
+		unsigned int levels = (1 << bits) - 1;
+		return min(levels, (unsigned int)floor(value * levels / 255.0f + threshold));
+	}
+
+	unsigned char CTextureEncoder::Intensity(const unsigned char *pixel)
+	{
+		return (unsigned char)((pixel[0] * 299 + pixel[1] * 587 + pixel[2] * 114 + 500) / 1000);
+	}
+
+	float CTextureEncoder::KaiserWeight(float offset, float radius)
+	{
+		// A sinc at half the source rate, windowed so the filter ends smoothly at the radius.
+		const float pi = 3.14159265f;
+		float x = offset / 2;
+		float sinc = x == 0 ? 1 : sin(pi * x) / (pi * x);
+
+		auto bessel = [](float value) {
+			float sum = 1, term = 1;
+			for (int k = 1; k < 16; k++)
+			{
+				term *= (value / (2 * k)) * (value / (2 * k));
+				sum += term;
+			}
+			return sum;
+		};
+
+		float ratio = offset / radius;
+		return sinc * bessel(kaiserBeta * sqrt(max(0.0f, 1 - ratio * ratio))) / bessel(kaiserBeta);
+	}
+
+	int CTextureEncoder::AddressTexel(int index, int size, TextureAddress::Value address)
+	{
+		switch (address)
+		{
+		case TextureAddress::Clamp:
+			return min(size - 1, max(0, index));
+		case TextureAddress::Mirror:
+		{
+			int period = ((index % (2 * size)) + 2 * size) % (2 * size);
+			return period < size ? period : 2 * size - 1 - period;
+		}
+		default:
+			return ((index % size) + size) % size;
+		}
+	}
+
+	float CTextureEncoder::BuildPalette(const unsigned char *rgba, int count, int entries, vector<unsigned short> *palette)
+	{
+		vector<PaletteColor> colors;
+		vector<int> opaque;
+		for (int i = 0; i < count; i++)
+		{
+			colors.push_back(ToColor(&rgba[i * 4]));
+			if (colors.back().opaque) opaque.push_back(i);
+		}
+
+		// Cut out pixels all share one fully transparent entry.
+		palette->clear();
+		if (opaque.size() < colors.size()) palette->push_back(0);
+		int available = entries - (int)palette->size();
+
+		// Median cut keeps splitting the box whose colours spread the most along
+		// one axis until every entry has a box.
+		vector<vector<int>> boxes;
+		if (!opaque.empty()) boxes.push_back(opaque);
+		while ((int)boxes.size() < available)
+		{
+			int widest = -1, widestAxis = 0;
+			float widestSpread = 0;
+			for (int i = 0; i < (int)boxes.size(); i++)
+			{
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float sum = 0, squares = 0;
+					for (auto index : boxes[i])
+					{
+						float value = colors[index].lab[axis];
+						sum += value;
+						squares += value * value;
+					}
+
+					float spread = squares - sum * sum / boxes[i].size();
+					if (spread > widestSpread)
+					{
+						widest = i;
+						widestAxis = axis;
+						widestSpread = spread;
+					}
+				}
+			}
+			if (widest < 0) break;
+
+			vector<int> &box = boxes[widest];
+			sort(box.begin(), box.end(), [&colors, widestAxis](int a, int b) {
+				return colors[a].lab[widestAxis] < colors[b].lab[widestAxis];
+			});
+			vector<int> upper(box.begin() + box.size() / 2, box.end());
+			box.resize(box.size() / 2);
+			boxes.push_back(upper);
+		}
+
+		vector<PaletteColor> centers;
+		for (auto &box : boxes)
+		{
+			PaletteColor center = { { 0, 0, 0 }, true };
+			for (auto index : box)
+			{
+				for (int axis = 0; axis < 3; axis++) center.lab[axis] += colors[index].lab[axis] / box.size();
+			}
+			centers.push_back(center);
+		}
+
+		// A few rounds of k-means pull the centers onto the colours the boxes cut apart.
+		for (int round = 0; round < kMeansRounds && !centers.empty(); round++)
+		{
+			vector<PaletteColor> sums(centers.size(), { { 0, 0, 0 }, true });
+			vector<int> members(centers.size(), 0);
+			for (auto index : opaque)
+			{
+				int nearest = 0;
+				for (int i = 1; i < (int)centers.size(); i++)
+				{
+					if (SquaredDistance(colors[index].lab, centers[i].lab) < SquaredDistance(colors[index].lab, centers[nearest].lab))
+						nearest = i;
+				}
+
+				for (int axis = 0; axis < 3; axis++) sums[nearest].lab[axis] += colors[index].lab[axis];
+				members[nearest]++;
+			}
+
+			for (int i = 0; i < (int)centers.size(); i++)
+			{
+				if (members[i] == 0) continue;
+				for (int axis = 0; axis < 3; axis++) centers[i].lab[axis] = sums[i].lab[axis] / members[i];
+			}
+		}
+
+		for (auto &center : centers) palette->push_back(ToEntry(center.lab));
+		palette->resize(entries, 0);
+		return MapColors(colors, *palette, count, false, NULL);
+	}
+
+	float CTextureEncoder::MapColors(const vector<PaletteColor> &colors, const vector<unsigned short> &palette,
+		int width, bool dither, vector<unsigned char> *indices)
+	{
+		vector<PaletteColor> entries;
+		for (auto entry : palette) entries.push_back(ToColor(entry));
+
+		float error = 0;
+		int measured = 0;
+		bool mismatched = false;
+		bool hasOpacity[2] = { false, false };
+		for (auto &entry : entries) hasOpacity[entry.opaque] = true;
+
+		for (int i = 0; i < (int)colors.size(); i++)
+		{
+			// Opaque pixels only map to opaque entries and cut out pixels to transparent ones,
+			// unless the palette has none of them which makes it unusable for the colours.
+			const PaletteColor &color = colors[i];
+			bool anyOpacity = !hasOpacity[color.opaque];
+			mismatched |= anyOpacity;
+
+			int nearest = -1, second = -1;
+			for (int j = 0; j < (int)entries.size(); j++)
+			{
+				if (entries[j].opaque != color.opaque && !anyOpacity) continue;
+				float distance = SquaredDistance(color.lab, entries[j].lab);
+				if (nearest < 0 || distance < SquaredDistance(color.lab, entries[nearest].lab))
+				{
+					second = nearest;
+					nearest = j;
+				}
+				else if (second < 0 || distance < SquaredDistance(color.lab, entries[second].lab))
+				{
+					second = j;
+				}
+			}
+
+			int choice = nearest;
+			if (color.opaque)
+			{
+				error += sqrt(SquaredDistance(color.lab, entries[nearest].lab));
+				measured++;
+
+				// Ordered dithering picks the second closest entry as often as the pixel
+				// lies towards it on the line between the two.
+				float span = second < 0 ? 0 : SquaredDistance(entries[nearest].lab, entries[second].lab);
+				if (dither && span > 0)
+				{
+					float along = 0;
+					for (int axis = 0; axis < 3; axis++)
+					{
+						along += (color.lab[axis] - entries[nearest].lab[axis])
+							* (entries[second].lab[axis] - entries[nearest].lab[axis]);
+					}
+
+					int x = i % width, y = i / width;
+					if (along / span > (bayer[y % 4][x % 4] + 0.5f) / 16) choice = second;
+				}
+			}
+
+			if (indices != NULL) indices->push_back((unsigned char)choice);
+		}
+
+		if (mismatched) return HUGE_VALF;
+		return measured > 0 ? error / measured : 0;
+	}
+
+	PaletteColor CTextureEncoder::ToColor(const unsigned char *pixel)
+	{
+		float linear[3];
+		for (int i = 0; i < 3; i++)
+		{
+			float value = pixel[i] / 255.0f;
+			linear[i] = value <= 0.04045f ? value / 12.92f : pow((value + 0.055f) / 1.055f, 2.4f);
+		}
+
+		float l = cbrt(0.4122214708f * linear[0] + 0.5363325363f * linear[1] + 0.0514459929f * linear[2]);
+		float m = cbrt(0.2119034982f * linear[0] + 0.6806995451f * linear[1] + 0.1073969566f * linear[2]);
+		float s = cbrt(0.0883024619f * linear[0] + 0.2817188376f * linear[1] + 0.6299787005f * linear[2]);
+
+		PaletteColor color = { {
+			0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s,
+			1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s,
+			0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s
+		}, pixel[3] >= 128 };
+		return color;
+	}
+
+	PaletteColor CTextureEncoder::ToColor(unsigned short entry)
+	{
+		// Five bit channels are widened the way the RDP does by repeating the top bits.
+		unsigned char pixel[4];
+		for (int i = 0; i < 3; i++)
+		{
+			unsigned int value = entry >> (11 - i * 5) & 0x1F;
+			pixel[i] = (unsigned char)(value << 3 | value >> 2);
+		}
+		pixel[3] = entry & 1 ? 255 : 0;
+		return ToColor(pixel);
+	}
+
+	unsigned short CTextureEncoder::ToEntry(const float *lab)
+	{
+		float l = lab[0] + 0.3963377774f * lab[1] + 0.2158037573f * lab[2];
+		float m = lab[0] - 0.1055613458f * lab[1] - 0.0638541728f * lab[2];
+		float s = lab[0] - 0.0894841775f * lab[1] - 1.2914855480f * lab[2];
+		l = l * l * l;
+		m = m * m * m;
+		s = s * s * s;
+
+		float linear[3] = {
+			4.0767416621f * l - 3.3077115913f * m + 0.2309699292f * s,
+			-1.2684380046f * l + 2.6097574011f * m - 0.3413193965f * s,
+			-0.0041960863f * l - 0.7034186147f * m + 1.7076147010f * s
+		};
+
+		unsigned short entry = 1;
+		for (int i = 0; i < 3; i++)
+		{
+			float value = min(1.0f, max(0.0f, linear[i]));
+			value = value <= 0.0031308f ? value * 12.92f : 1.055f * pow(value, 1 / 2.4f) - 0.055f;
+			entry |= (unsigned short)min(31, (int)floor(value * 31 + 0.5f)) << (11 - i * 5);
+		}
+		return entry;
+	}
+
+	float CTextureEncoder::SquaredDistance(const float *a, const float *b)
+	{
+		return (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]) + (a[2] - b[2]) * (a[2] - b[2]);
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	struct TextureFormat
+	{
+		enum Value { Auto, RGBA16, RGBA32, IA8, IA16, I4, I8, CI4, CI8 };
+	};
+
+	// Values match G_TX_WRAP, G_TX_MIRROR and G_TX_CLAMP.
+	struct TextureAddress
+	{
+		enum Value { Wrap, Mirror, Clamp };
+	};
+
+	struct MipFilter
+	{
+		enum Value { None, Box, Kaiser };
+	};
+
+	typedef struct
+	{
+		TextureFormat::Value format;
+		bool dither;
+		TextureAddress::Value address;
+		MipFilter::Value mipFilter;
+	} TextureOptions;
+
+	// Colours are compared in Oklab where equal distances look about equally different.
+	typedef struct
+	{
+		float lab[3];
+		bool opaque;
+	} PaletteColor;
+
+	// Converts RGBA images into texels the RDP loads as they are, behind a small
+	// header the engine reads to know how to load them. Every mip level follows
+	// the first and colour indexed textures end with their RGBA16 palette.
+	class CTextureEncoder
+	{
+	public:
+		static string Encode(const unsigned char *rgba, int width, int height, const TextureOptions &options);
+		static TextureFormat::Value ResolveFormat(const unsigned char *rgba, int width, int height,
+			TextureFormat::Value format, vector<unsigned short> *palette = NULL);
+		static TextureFormat::Value SelectFormat(const unsigned char *rgba, int width, int height);
+		static TextureFormat::Value ParseFormat(const string &name);
+		static MipFilter::Value ParseMipFilter(const string &name);
+		static int TexelBits(TextureFormat::Value format);
+		static void FitSize(int width, int height, int *fitWidth, int *fitHeight);
+		static int LevelCount(TextureFormat::Value format, int width, int height, MipFilter::Value filter);
+		static size_t TmemBytes(TextureFormat::Value format, int width, int height, int levels);
+		static bool FitsTmem(TextureFormat::Value format, int width, int height, int levels);
+		static vector<unsigned char> Downsample(const unsigned char *rgba, int width, int height, MipFilter::Value filter,
+			TextureAddress::Value address);
+		static int PaletteEntries(const string &texture);
+		static int SharePalettes(vector<string> &textures);
+
+	private:
+		CTextureEncoder() {}
+		static string EncodeTexels(const unsigned char *rgba, int width, int height, TextureFormat::Value format,
+			const vector<unsigned short> &palette, bool dither);
+		static unsigned int Quantize(unsigned char value, int bits, float threshold);
+		static unsigned char Intensity(const unsigned char *pixel);
+		static float KaiserWeight(float offset, float radius);
+		static int AddressTexel(int index, int size, TextureAddress::Value address);
+		static float BuildPalette(const unsigned char *rgba, int count, int entries, vector<unsigned short> *palette);
+		static float MapColors(const vector<PaletteColor> &colors, const vector<unsigned short> &palette,
+			int width, bool dither, vector<unsigned char> *indices);
+		static PaletteColor ToColor(const unsigned char *pixel);
+		static PaletteColor ToColor(unsigned short entry);
+		static unsigned short ToEntry(const float *lab);
+		static float SquaredDistance(const float *a, const float *b);
+	};
+}
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include "Undo.h"
+
+namespace UltraEd
+{
+	// Fixed cost of a step on top of the state it holds.
+	const size_t stepOverhead = sizeof(UndoStep);
+
+	CUndo::CUndo()
+	{
+		m_budget = 8 * 1024 * 1024;
+		m_usedBytes = 0;
+	}
+
+	void CUndo::Push(const UndoStep &step)
+	{
+		// A new step makes everything that was undone unreachable.
+		for (auto &redo : m_redo) m_usedBytes -= redo.size + stepOverhead;
+		m_redo.clear();
+
+		m_undo.push_back(step);
+		m_usedBytes += step.size + stepOverhead;
+		Trim();
+	}
+
+	bool CUndo::Undo()
+	{
+		if (m_undo.empty()) return false;
+
+		UndoStep step = move(m_undo.back());
+		m_undo.pop_back();
+		step.undo();
+		m_redo.push_back(step);
+
+		return true;
+	}
+
+	bool CUndo::Redo()
+	{
+		if (m_redo.empty()) return false;
+
+		UndoStep step = move(m_redo.back());
+		m_redo.pop_back();
+		step.redo();
+		m_undo.push_back(step);
+
+		return true;
+	}
+
+	void CUndo::Clear()
+	{
+		m_undo.clear();
+		m_redo.clear();
+		m_usedBytes = 0;
+	}
+
+	void CUndo::SetBudget(size_t bytes)
+	{
+		m_budget = bytes;
+		Trim();
+	}
+
+	void CUndo::Merge(UndoStep &older, const UndoStep &newer)
+	{
+		// Keep the state from before the older step and after the newer one.
+		m_usedBytes -= older.size;
+		older.redo = newer.redo;
+		older.size = max(older.size, newer.size);
+		m_usedBytes += older.size;
+	}
+
+	void CUndo::Trim()
+	{
+		while (m_usedBytes > m_budget && m_undo.size() > 1)
+		{
+			// Collapse the oldest neighbouring steps that touch the same state
+			// before giving up the oldest step altogether.
+			bool merged = false;
+			for (size_t i = 0; i + 2 < m_undo.size(); i++)
+			{
+				if (!m_undo[i].mergeKey.empty() && m_undo[i].mergeKey == m_undo[i + 1].mergeKey)
+				{
+					Merge(m_undo[i], m_undo[i + 1]);
+					m_usedBytes -= m_undo[i + 1].size + stepOverhead;
+					m_undo.erase(m_undo.begin() + i + 1);
+					merged = true;
+					break;
+				}
+			}
+
+			if (!merged)
+			{
+				m_usedBytes -= m_undo.front().size + stepOverhead;
+				m_undo.pop_front();
+			}
+		}
+	}
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		// Old neighbouring steps sharing a non-empty key may be collapsed into one.
+		string mergeKey;
+		size_t size;
+		function<void()> undo;
+		function<void()> redo;
+	} UndoStep;
+
+	// Journal of reversible steps. Each step only holds the state it changed so
+	// undoing and redoing costs as much as the change itself, and the memory used
+	// by the journal is kept under a budget by collapsing or dropping old steps.
+	class CUndo
+	{
+	public:
+		CUndo();
+		void Push(const UndoStep &step);
+		bool Undo();
+		bool Redo();
+		void Clear();
+		void SetBudget(size_t bytes);
+		bool CanUndo() { return !m_undo.empty(); }
+		bool CanRedo() { return !m_redo.empty(); }
+		size_t GetCount() { return m_undo.size(); }
+		size_t GetUsedBytes() { return m_usedBytes; }
+
+	private:
+		void Merge(UndoStep &older, const UndoStep &newer);
+		void Trim();
+
+	private:
+		deque<UndoStep> m_undo;
+		vector<UndoStep> m_redo;
+		size_t m_budget;
+		size_t m_usedBytes;
+	};
+}
@@ -0,0 +1,106 @@
+#include "VertexBufferPool.h"
+
+namespace UltraEd
+{
+	CVertexBufferPool *CVertexBufferPool::m_instance = &Instance();
+
+	CVertexBufferPool::CVertexBufferPool() : m_manager(this)
+	{
+		m_device = 0;
+	}
+
+	CVertexBufferPool::~CVertexBufferPool()
+	{
+		for (auto buffer : m_buffers)
+		{
+			if (buffer.second.buffer != NULL) buffer.second.buffer->Release();
+		}
+	}
+
+	CVertexBufferPool &CVertexBufferPool::Instance()
+	{
+		if (m_instance == NULL) m_instance = new CVertexBufferPool;
+		return *m_instance;
+	}
+
+	IDirect3DVertexBuffer8 *CVertexBufferPool::Get(IDirect3DDevice8 *device, ResourceId *id, size_t count,
+		function<void(Vertex*)> fill, DWORD fvf, ResourcePriority::Value priority)
+	{
+		if (count == 0) return NULL;
+
+		m_device = device;
+
+		if (m_buffers.find(*id) == m_buffers.end())
+		{
+			*id = m_manager.Add(count * sizeof(Vertex), priority);
+			PooledBuffer pooled = { NULL, count, fill, fvf };
+			m_buffers[*id] = pooled;
+		}
+
+		if (!m_manager.Use(*id)) return NULL;
+
+		return m_buffers[*id].buffer;
+	}
+
+	void CVertexBufferPool::Release(ResourceId *id)
+	{
+		if (m_buffers.find(*id) == m_buffers.end()) return;
+
+		m_manager.Remove(*id);
+		m_buffers.erase(*id);
+		*id = 0;
+	}
+
+	void CVertexBufferPool::SetPriority(ResourceId id, ResourcePriority::Value priority)
+	{
+		m_manager.SetPriority(id, priority);
+	}
+
+	void CVertexBufferPool::SetBudget(size_t bytes)
+	{
+		m_manager.SetBudget(bytes);
+	}
+
+	void CVertexBufferPool::NextFrame()
+	{
+		m_manager.NextFrame();
+	}
+
+	bool CVertexBufferPool::Allocate(ResourceId id)
+	{
+		PooledBuffer &pooled = m_buffers[id];
+		UINT size = pooled.count * sizeof(Vertex);
+
+		// Managed buffers keep a copy the runtime restores itself, so they survive a device reset.
+		if (m_device == NULL || FAILED(m_device->CreateVertexBuffer(size, D3DUSAGE_WRITEONLY,
+			pooled.fvf, D3DPOOL_MANAGED, &pooled.buffer)))
+		{
+			pooled.buffer = 0;
+			return false;
+		}
+
+		VOID *pVertices;
+		if (FAILED(pooled.buffer->Lock(0, size, (BYTE**)&pVertices, 0)))
+		{
+			pooled.buffer->Release();
+			pooled.buffer = 0;
+			return false;
+		}
+
+		// The owner writes its vertices straight into the buffer.
+		pooled.fill((Vertex*)pVertices);
+		pooled.buffer->Unlock();
+
+		return true;
+	}
+
+	void CVertexBufferPool::Free(ResourceId id)
+	{
+		PooledBuffer &pooled = m_buffers[id];
+		if (pooled.buffer != NULL)
+		{
+			pooled.buffer->Release();
+			pooled.buffer = 0;
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include "ResourceManager.h"
+#include "Vertex.h"
+
+using namespace std;
+
+namespace UltraEd
+{
+	typedef struct
+	{
+		IDirect3DVertexBuffer8 *buffer;
+		size_t count;
+		function<void(Vertex*)> fill;
+		DWORD fvf;
+	} PooledBuffer;
+
+	class CVertexBufferPool : public CResourceAllocator
+	{
+	public:
+		CVertexBufferPool();
+		~CVertexBufferPool();
+		static CVertexBufferPool &Instance();
+		IDirect3DVertexBuffer8 *Get(IDirect3DDevice8 *device, ResourceId *id, size_t count,
+			function<void(Vertex*)> fill, DWORD fvf, ResourcePriority::Value priority);
+		void Release(ResourceId *id);
+		void SetPriority(ResourceId id, ResourcePriority::Value priority);
+		void SetBudget(size_t bytes);
+		void NextFrame();
+		bool Allocate(ResourceId id);
+		void Free(ResourceId id);
+
+	private:
+		static CVertexBufferPool *m_instance;
+		CResourceManager m_manager;
+		map<ResourceId, PooledBuffer> m_buffers;
+		IDirect3DDevice8 *m_device;
+	};
+}
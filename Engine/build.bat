@@ -1,4 +1,3 @@
 SET PATH=%PATH%;%ROOT%
 call setupgcc.bat
-make clean
-make
+make -j %NUMBER_OF_PROCESSORS%
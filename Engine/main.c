@@ -1,15 +1,7 @@
-#include <nusys.h>
-#include <math.h>
-#include "hashtable.h"
-#include "sos.h"
-#include "segments.h"
-#include "models.h"
-#include "mappings.h"
-#include "cameras.h"
-#include "utilities.h"
-#include "scripts.h"
+#include "scene.h"
 
 #define GFX_GLIST_LEN 2048
+#define ASSET_BASE_OFFSET 0x18
 
 char mem_heep[1024*512];
 Gfx *glistp;
@@ -18,6 +10,7 @@ struct transform world;
 u16 perspNormal;
 NUContData contdata[4];
 int currentCamera = 0;
+u8 *_UER_AssetBase;
 
 static Vp viewPort = 
 {
@@ -94,6 +87,7 @@ void createDisplayList()
   rcpInit();
   clearFramBuffer();
   setup_world_matrix(&glistp);
+  sos_draw_begin(_UER_Cameras[currentCamera]);
   _UER_Draw(&glistp);
   gDPFullSync(glistp++);
   gSPEndDisplayList(glistp++);
@@ -122,6 +116,15 @@ void gfxCallback(int pendingGfx)
   if(pendingGfx < 1) createDisplayList();
 }
 
+void loadAssetBase()
+{
+  /* The editor writes the ROM offset of the asset segment into the header. The
+     buffer fills a whole cache line since the DMA invalidates it. */
+  static u32 header[4] __attribute__((aligned(16)));
+  nuPiReadRom(ASSET_BASE_OFFSET, header, sizeof(header));
+  _UER_AssetBase = (u8*)header[0];
+}
+
 int initHeapMemory() 
 {
   if(InitHeap(mem_heep, sizeof(mem_heep)) == -1) 
@@ -138,6 +141,7 @@ void mainproc()
   
   if(initHeapMemory() > -1)
   {
+    loadAssetBase();
     _UER_Load();
     _UER_Mappings();
     _UER_Camera();
@@ -0,0 +1,35 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include <nusys.h>
+#include <math.h>
+#include "hashtable.h"
+#include "sos.h"
+#include "utilities.h"
+
+/* Models and textures are packed into one ROM segment and found by index. */
+struct asset {
+  u32 offset;
+  u32 size;
+};
+
+#define ASSET_START(INDEX) (_UER_AssetBase + _UER_Assets[INDEX].offset)
+#define ASSET_END(INDEX) (ASSET_START(INDEX) + _UER_Assets[INDEX].size)
+
+/* Read from the ROM header at boot. */
+extern u8 *_UER_AssetBase;
+
+/* Defined by the sources the editor generates for each scene. */
+extern struct asset _UER_Assets[];
+extern struct sos_model *_UER_Models[];
+extern struct sos_model *_UER_Cameras[];
+
+void _UER_Load();
+void _UER_Draw(Gfx **display_list);
+void _UER_Camera();
+void _UER_Mappings();
+void _UER_Start();
+void _UER_Update();
+void _UER_Input(NUContData gamepads[4]);
+
+#endif
\ No newline at end of file
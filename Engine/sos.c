@@ -1,8 +1,61 @@
 #include <nusys.h>
-#include "upng.h"
-#include "sos.h"
+#include "scene.h"
 
-#define RGB5551(R, G, B) (((R >> 3) << 11) | ((G >> 3) << 6) | ((B >> 3) << 1) | 1)
+/* Palettes shared by several textures are only loaded once. */
+struct sos_palette {
+  u32 asset;
+  u16 *tlut;
+  struct sos_palette *next;
+};
+
+static struct sos_palette *palettes = NULL;
+
+/* Models sharing a texture or atlas share the first one's texels and texture list. */
+struct sos_texture {
+  void *start;
+  struct sos_model *model;
+  struct sos_texture *next;
+};
+
+static struct sos_texture *textures = NULL;
+
+/* Texture list of the model drawn last, so models drawn in a row with the same
+   texture only set their state once. */
+static Gfx *bound_texture = NULL;
+static int state_bound = 0;
+
+/* Where the camera drawing the frame is, to pick each model's level of detail. */
+static float eye[3];
+
+/* A model only changes level once the camera is this much past the distance
+   between them so it doesn't flicker back and forth. */
+#define LOD_HYSTERESIS 0.1F
+
+/* Compressed meshes are read from ROM a block at a time while they are decoded. */
+#define STREAM_BLOCK 512
+
+struct bit_stream {
+  u8 *rom;
+  u32 remaining;
+  u32 position;
+  u32 length;
+  u32 bits;
+  int count;
+};
+
+static u8 stream_block[STREAM_BLOCK] __attribute__((aligned(16)));
+
+/* State every untextured model draws with. Texture lists start by setting the same. */
+static Gfx untextured_state[] = {
+  gsDPPipeSync(),
+  gsDPSetCycleType(G_CYC_1CYCLE),
+  gsDPSetRenderMode(G_RM_AA_ZB_OPA_SURF, G_RM_AA_ZB_OPA_SURF2),
+  gsSPClearGeometryMode(0xFFFFFFFF),
+  gsSPSetGeometryMode(G_SHADE | G_SHADING_SMOOTH | G_ZBUFFER | G_CULL_FRONT),
+  gsSPTexture(0, 0, 0, 0, G_OFF),
+  gsDPSetCombineMode(G_CC_SHADE, G_CC_SHADE),
+  gsSPEndDisplayList()
+};
 
 void rom_2_ram(void *from_addr, void *to_addr, s32 seq_size) {
   // If size is odd-numbered, cannot send over PI, so make it even.
@@ -10,20 +63,25 @@ void rom_2_ram(void *from_addr, void *to_addr, s32 seq_size) {
   nuPiReadRom((u32)from_addr, to_addr, seq_size);
 }
 
-unsigned short* image_24_to_16(const unsigned char* data,
-                               const int size_x, const int size_y) {
-  int x, y;
-  unsigned short* temp = (unsigned short*)malloc(size_x * size_y * 2);
-  
-  for(y = 0; y < size_y; y++) {
-    for(x = 0; x < size_x; x++) {
-      temp[x + y * size_y] = RGB5551(data[x * 3 + y * size_y * 3],
-        data[x * 3 + y * size_y * 3 + 1],
-        data[x * 3 + y * size_y * 3 + 2]);
-    }
+void *malloc_aligned(s32 size) {
+  // DMA invalidates whole cache lines so buffers it writes must not share them.
+  return (void*)(((u32)malloc(size + 15) + 15) & ~15);
+}
+
+u16 *load_palette(u32 asset, int entries) {
+  struct sos_palette *palette;
+
+  for(palette = palettes; palette != NULL; palette = palette->next) {
+    if(palette->asset == asset) return palette->tlut;
   }
-  
-  return temp;
+
+  palette = (struct sos_palette*)malloc(sizeof(struct sos_palette));
+  palette->asset = asset;
+  palette->tlut = (u16*)malloc_aligned(entries * sizeof(u16));
+  rom_2_ram(ASSET_START(asset), palette->tlut, entries * sizeof(u16));
+  palette->next = palettes;
+  palettes = palette;
+  return palette->tlut;
 }
 
 struct sos_model *load_sos_model(void *data_start, void *data_end,
@@ -34,54 +92,164 @@ struct sos_model *load_sos_model(void *data_start, void *data_end,
     NULL, NULL, positionX, positionY, positionZ, rotX, rotY, rotZ, angle, scaleX, scaleY, scaleZ);
 }
 
+u32 read_bits(struct bit_stream *stream, int count) {
+  // Bits come most significant first, topped up a byte at a time.
+  while(stream->count < count) {
+    if(stream->position == stream->length) {
+      stream->length = stream->remaining < STREAM_BLOCK ? stream->remaining : STREAM_BLOCK;
+      if(stream->length == 0) return 0;
+      rom_2_ram(stream->rom, stream_block, stream->length);
+      stream->rom += stream->length;
+      stream->remaining -= stream->length;
+      stream->position = 0;
+    }
+    stream->bits = stream->bits << 8 | stream_block[stream->position++];
+    stream->count += 8;
+  }
+  stream->count -= count;
+  return (stream->bits >> stream->count) & ((1 << count) - 1);
+}
+
+u32 read_gamma(struct bit_stream *stream) {
+  int width = 0;
+  while(width < 16 && read_bits(stream, 1) == 0) width++;
+  return (1 << width) | read_bits(stream, width);
+}
+
+void sos_decode_mesh(struct mesh *mesh, struct bit_stream *stream, u8 *table, int batch_count, int triangle_count) {
+  int i, j, axis;
+  int vertex_count, batch_triangles, next;
+  int vertices_left = mesh->vertex_count;
+  int triangles_left = triangle_count;
+  s32 value;
+  s16 base[3], first[2];
+  int widths[5], shifts[5];
+  Vtx *vertex = mesh->vertices;
+  u8 *slots = table + batch_count * 2;
+  
+  for(i = 0; i < batch_count; i++) {
+    vertex_count = read_bits(stream, 8);
+    batch_triangles = read_bits(stream, 8);
+    
+    // A stream that disagrees with its header stops before writing past what was allocated
+    // for it, leaving the batches it didn't reach empty.
+    if(vertex_count > vertices_left || batch_triangles > triangles_left) {
+      for(; i < batch_count; i++) table[i * 2] = table[i * 2 + 1] = 0;
+      return;
+    }
+    vertices_left -= vertex_count;
+    triangles_left -= batch_triangles;
+    table[i * 2] = vertex_count;
+    table[i * 2 + 1] = batch_triangles;
+    
+    for(axis = 0; axis < 3; axis++) {
+      base[axis] = read_bits(stream, 16);
+      widths[axis] = read_bits(stream, 5);
+      shifts[axis] = read_bits(stream, 4);
+    }
+    for(axis = 0; axis < 2; axis++) {
+      first[axis] = read_bits(stream, 16);
+      widths[3 + axis] = read_bits(stream, 5);
+      shifts[3 + axis] = read_bits(stream, 4);
+    }
+    
+    // Positions are offsets from the batch's smallest and coordinates follow on from
+    // the vertex before, both without the low bits the whole batch leaves clear.
+    for(j = 0; j < vertex_count; j++, vertex++) {
+      for(axis = 0; axis < 3; axis++) {
+        vertex->v.ob[axis] = base[axis] + (read_bits(stream, widths[axis]) << shifts[axis]);
+      }
+      for(axis = 0; axis < 2; axis++) {
+        if(j == 0) {
+          vertex->v.tc[axis] = first[axis];
+          continue;
+        }
+        value = read_bits(stream, widths[3 + axis]);
+        value = (value >> 1) ^ -(value & 1);
+        vertex->v.tc[axis] = vertex[-1].v.tc[axis] + value * (1 << shifts[3 + axis]);
+      }
+      vertex->v.flag = 0;
+      vertex->v.cn[0] = vertex->v.cn[1] = vertex->v.cn[2] = vertex->v.cn[3] = 0;
+    }
+    
+    // A set bit is the next vertex used for the first time, otherwise how far back it is.
+    for(j = 0, next = 0; j < batch_triangles * 3; j++) {
+      *slots++ = read_bits(stream, 1) ? next++ : next - read_gamma(stream);
+    }
+  }
+}
+
+struct mesh *load_mesh(u8 **data, struct sos_mesh_header *header) {
+  int i = 0;
+  int vertex_bytes = 0;
+  u8 *table;
+  struct mesh *mesh;
+  struct bit_stream stream;
+  
+  // Transfer from ROM the mesh header.
+  rom_2_ram(*data, header, sizeof(struct sos_mesh_header));
+  
+  // The compressed stream is decoded straight into the vertices as it's read in, along
+  // with the batch table that is only needed to build the mesh's display list.
+  mesh = (struct mesh*)malloc(sizeof(struct mesh));
+  vertex_bytes = header->vertex_count * sizeof(Vtx);
+  mesh->vertices = (Vtx*)malloc_aligned(vertex_bytes);
+  mesh->vertex_count = header->vertex_count;
+  table = (u8*)malloc(header->batch_count * 2 + header->triangle_count * 3);
+  
+  stream.rom = *data + sizeof(struct sos_mesh_header);
+  stream.remaining = header->stream_bytes;
+  stream.position = stream.length = 0;
+  stream.bits = 0;
+  stream.count = 0;
+  sos_decode_mesh(mesh, &stream, table, header->batch_count, header->triangle_count);
+  
+  // The RSP reads the vertices straight from memory.
+  osWritebackDCache(mesh->vertices, vertex_bytes);
+  mesh->display_list = sos_build_mesh(mesh, table, header->batch_count, header->triangle_count);
+  free(table);
+  
+  // The middle of the bounds is kept in quantized units so the model's scale applies to it.
+  for(i = 0; i < 3; i++) {
+    mesh->bounds_min[i] = header->bounds_min[i];
+    mesh->bounds_max[i] = header->bounds_max[i];
+    mesh->center[i] = (header->bounds_min[i] + header->bounds_max[i]) / 2 / header->scale;
+  }
+  mesh->level = 0;
+  mesh->lod_distance = header->lod_distance;
+  mesh->lower = NULL;
+  
+  *data += sizeof(struct sos_mesh_header) + ((header->stream_bytes + 1) & ~1);
+  return mesh;
+}
+
 struct sos_model *load_sos_model_with_texture(void *data_start, void *data_end,
                                  void *texture_start, void *texture_end,
                                  double positionX, double positionY, double positionZ,
                                  double rotX, double rotY, double rotZ, double angle,
                                  double scaleX, double scaleY, double scaleZ) {
-  unsigned char data_buffer[200000];
-  unsigned char texture_buffer[20000];
-  char *line;
-  int data_size = data_end - data_start;
-  int texture_size = texture_end - texture_start;
-  int i = 0;
-  int vertex_count = 0;
+  static struct sos_mesh_header header __attribute__((aligned(16)));
+  static struct sos_texture_header texture_header __attribute__((aligned(16)));
+  u8 *data = (u8*)data_start;
+  struct mesh *mesh;
   struct sos_model *new_model;
-  upng_t* png;
-  
-  // Transfer from ROM the model mesh data and texture.
-  rom_2_ram(data_start, data_buffer, data_size);
-  rom_2_ram(texture_start, texture_buffer, texture_size);
+  struct sos_texture *texture;
   
   new_model = (struct sos_model*)malloc(sizeof(struct sos_model));
-  new_model->mesh = (struct mesh*)malloc(sizeof(struct mesh));
   new_model->position = (struct vector3*)malloc(sizeof(struct vector3));
   new_model->rotationAxis = (struct vector3*)malloc(sizeof(struct vector3));
   new_model->scale = (struct vector3*)malloc(sizeof(struct vector3));
+  new_model->texture = NULL;
+  new_model->palette = NULL;
+  new_model->texture_list = NULL;
   new_model->visible = 1;
   
-  // Read how many vertices for this mesh.
-  line = (char*)strtok(data_buffer, "\n");
-  sscanf(line, "%i", &vertex_count);
-  new_model->mesh->vertices = (Vtx*)malloc(vertex_count * sizeof(Vtx));
-  new_model->mesh->vertex_count = vertex_count;
-  
-  // Gather all of the X, Y, and Z vertex info.
-  for(i = 0; i < vertex_count; i++) {
-    double x, y, z, s, t;
-    line = (char*)strtok(NULL, "\n");
-    sscanf(line, "%lf %lf %lf %lf %lf", &x, &y, &z, &s, &t);
-    
-    new_model->mesh->vertices[i].v.ob[0] = x * 1000;
-    new_model->mesh->vertices[i].v.ob[1] = y * 1000;
-    new_model->mesh->vertices[i].v.ob[2] = -z * 1000;
-    new_model->mesh->vertices[i].v.flag = 0;
-    new_model->mesh->vertices[i].v.tc[0] = (int)(s * 32) << 5;
-    new_model->mesh->vertices[i].v.tc[1] = (int)(t * 32) << 5;
-    new_model->mesh->vertices[i].v.cn[0] = 0;
-    new_model->mesh->vertices[i].v.cn[1] = 0;
-    new_model->mesh->vertices[i].v.cn[2] = 0;
-    new_model->mesh->vertices[i].v.cn[3] = 0;
+  // Coarser levels of detail follow the full mesh, all quantized the same way.
+  new_model->lods = load_mesh(&data, &header);
+  new_model->mesh = new_model->lods;
+  for(mesh = new_model->lods; mesh->level + 1 < header.lod_count; mesh = mesh->lower) {
+    mesh->lower = load_mesh(&data, &header);
+    mesh->lower->level = mesh->level + 1;
   }
 
   // Entire axis can't be zero or it won't render.
@@ -90,94 +258,245 @@ struct sos_model *load_sos_model_with_texture(void *data_start, void *data_end,
   new_model->position->x = positionX;
   new_model->position->y = positionY;
   new_model->position->z = -positionZ;
-  new_model->scale->x = scaleX * 0.001;
-  new_model->scale->y = scaleY * 0.001;
-  new_model->scale->z = scaleZ * 0.001;
+  new_model->scale->x = scaleX * header.scale;
+  new_model->scale->y = scaleY * header.scale;
+  new_model->scale->z = scaleZ * header.scale;
   new_model->rotationAxis->x = rotX;
   new_model->rotationAxis->y = rotY;
   new_model->rotationAxis->z = -rotZ;
   new_model->rotationAngle = -angle;
 
-  // Load in the png texture data.
-  png = upng_new_from_bytes(texture_buffer, texture_size);
-  if (png != NULL) {
-    upng_decode(png);
-    
-    if (upng_get_error(png) == UPNG_EOK) {
-      // Convert texture data from 24bpp to 16bpp in RGB5551 format.
-      new_model->texture = image_24_to_16(upng_get_buffer(png), 32, 32);
+  // A texture already loaded by another model is shared rather than loaded again.
+  for(texture = textures; texture_end != texture_start && texture != NULL; texture = texture->next) {
+    if(texture->start != texture_start) continue;
+    new_model->texture_info = texture->model->texture_info;
+    new_model->texture = texture->model->texture;
+    new_model->palette = texture->model->palette;
+    new_model->texture_list = texture->model->texture_list;
+    return new_model;
+  }
+
+  // Textures are already in the format the RDP loads so they only need copying.
+  if(texture_end != texture_start) {
+    rom_2_ram(texture_start, &texture_header, sizeof(texture_header));
+    new_model->texture_info = texture_header;
+    new_model->texture = malloc_aligned(texture_header.texel_bytes);
+    rom_2_ram((u8*)texture_start + sizeof(texture_header), new_model->texture, texture_header.texel_bytes);
+
+    if(texture_header.palette_entries > 0) {
+      new_model->palette = load_palette(texture_header.palette_asset, texture_header.palette_entries);
     }
-    
-    upng_free(png);
+    new_model->texture_list = sos_build_texture(new_model);
+
+    texture = (struct sos_texture*)malloc(sizeof(struct sos_texture));
+    texture->start = texture_start;
+    texture->model = new_model;
+    texture->next = textures;
+    textures = texture;
   }
   
   return new_model;
 }
 
-void sos_draw(struct sos_model *model, Gfx **display_list) {
-  int i;
-  int remaining_vertices = model->mesh->vertex_count;
+int texture_mask(int size) {
+  int mask = 0;
+  while((1 << mask) < size) mask++;
+  return mask;
+}
+
+Gfx *sos_build_mesh(struct mesh *mesh, u8 *table, int batch_count, int triangle_count) {
+  int i, j;
+  int vertex_count, batch_triangles;
   int offset = 0;
+  u8 *slots = table + batch_count * 2;
+  s32 list_bytes = (batch_count * 2 + triangle_count / 2 + 1) * sizeof(Gfx);
+  Gfx *start = (Gfx*)malloc_aligned(list_bytes);
+  Gfx *display_list = start;
 
-  if(!model->visible) return;
-  
-  guTranslate(&model->transform.translation, model->position->x,
-    model->position->y, model->position->z);
-  
-  guRotate(&model->transform.rotation, model->rotationAngle, 
-    model->rotationAxis->x, model->rotationAxis->y, model->rotationAxis->z);
-  
-  guScale(&model->transform.scale, model->scale->x,
-    model->scale->y, model->scale->z);
+  // Each batch fills the vertex buffer once and draws the triangles using it two at a time.
+  // Loading vertices doesn't touch the RDP so no sync is needed in between.
+  for(i = 0; i < batch_count; i++) {
+    vertex_count = table[i * 2];
+    batch_triangles = table[i * 2 + 1];
+    if(vertex_count == 0) continue;
+    gSPVertex(display_list++, &(mesh->vertices[offset]), vertex_count, 0);
+
+    for(j = 0; j + 1 < batch_triangles; j += 2) {
+      gSP2Triangle(display_list++, slots[0], slots[1], slots[2], 0, slots[3], slots[4], slots[5], 0);
+      slots += 6;
+    }
+
+    if(j < batch_triangles) {
+      gSP1Triangle(display_list++, slots[0], slots[1], slots[2], 0);
+      slots += 3;
+    }
+
+    offset += vertex_count;
+  }
+
+  gSPEndDisplayList(display_list++);
+
+  // The RSP reads the list straight from memory.
+  osWritebackDCache(start, list_bytes);
+  return start;
+}
+
+Gfx *sos_build_texture(struct sos_model *model) {
+  struct sos_texture_header *info = &model->texture_info;
+  u8 *texels = (u8*)model->texture;
+  int width = info->width;
+  int height = info->height;
+  int level, bytes, tmem = 0;
+  s32 list_bytes = (20 + info->levels * 7) * sizeof(Gfx);
+  Gfx *start = (Gfx*)malloc_aligned(list_bytes);
+  Gfx *display_list = start;
+
+  // The list sets all the state models using the texture draw with.
+  gDPPipeSync(display_list++);
+  gSPClearGeometryMode(display_list++, 0xFFFFFFFF);
+  gSPSetGeometryMode(display_list++, G_SHADE | G_SHADING_SMOOTH | G_ZBUFFER | G_CULL_FRONT);
+  gDPSetTextureFilter(display_list++, G_TF_BILERP);
+  gDPSetTexturePersp(display_list++, G_TP_PERSP);
+  gSPTexture(display_list++, 0xffff, 0xffff, info->levels - 1, G_TX_RENDERTILE, G_ON);
+
+  // Trilinear filtering blends two levels in the first cycle and passes them through the second,
+  // since the vertices carry no colour to shade with.
+  if(info->levels > 1) {
+    gDPSetCycleType(display_list++, G_CYC_2CYCLE);
+    gDPSetRenderMode(display_list++, G_RM_PASS, G_RM_AA_ZB_OPA_SURF2);
+    gDPSetTextureLOD(display_list++, G_TL_LOD);
+    gDPSetTextureDetail(display_list++, G_TD_CLAMP);
+    gDPSetCombineMode(display_list++, G_CC_TRILERP, G_CC_PASS2);
+  } else {
+    gDPSetCycleType(display_list++, G_CYC_1CYCLE);
+    gDPSetRenderMode(display_list++, G_RM_AA_ZB_OPA_SURF, G_RM_AA_ZB_OPA_SURF2);
+    gDPSetTextureLOD(display_list++, G_TL_TILE);
+    gDPSetCombineMode(display_list++, G_CC_BLENDRGBA, G_CC_BLENDRGBA);
+  }
+
+  // Colour indexed texels look their colours up in a palette loaded into the upper half of TMEM.
+  if(model->palette != NULL) {
+    gDPSetTextureLUT(display_list++, G_TT_RGBA16);
+    if(info->palette_entries > 16) {
+      gDPLoadTLUT_pal256(display_list++, model->palette);
+    } else {
+      gDPLoadTLUT_pal16(display_list++, 0, model->palette);
+    }
+  } else {
+    gDPSetTextureLUT(display_list++, G_TT_NONE);
+  }
+
+  // Every level gets the tile matching its LOD and is loaded right after the one before.
+  // The load macros paste the texel size into their names so each size needs its own call.
+  for(level = 0; level < info->levels; level++) {
+    switch(info->size) {
+      case G_IM_SIZ_4b:
+        gDPLoadMultiBlock_4b(display_list++, texels, tmem, level, info->format, width, height, 0,
+          info->address, info->address, texture_mask(width), texture_mask(height), level, level);
+        break;
+      case G_IM_SIZ_8b:
+        gDPLoadMultiBlock(display_list++, texels, tmem, level, info->format, G_IM_SIZ_8b, width, height, 0,
+          info->address, info->address, texture_mask(width), texture_mask(height), level, level);
+        break;
+      case G_IM_SIZ_32b:
+        gDPLoadMultiBlock(display_list++, texels, tmem, level, info->format, G_IM_SIZ_32b, width, height, 0,
+          info->address, info->address, texture_mask(width), texture_mask(height), level, level);
+        break;
+      default:
+        gDPLoadMultiBlock(display_list++, texels, tmem, level, info->format, G_IM_SIZ_16b, width, height, 0,
+          info->address, info->address, texture_mask(width), texture_mask(height), level, level);
+        break;
+    }
+
+    bytes = (width * (4 << info->size) + 7) / 8 * height;
+    texels += bytes;
+    tmem += bytes / 8;
+    if(width > 1) width /= 2;
+    if(height > 1) height /= 2;
+  }
+
+  gSPEndDisplayList(display_list++);
+
+  // The RSP reads the list straight from memory.
+  osWritebackDCache(start, list_bytes);
+  return start;
+}
+
+void sos_draw_begin(struct sos_model *camera) {
+  // Every frame starts from the state rcpInit sets.
+  state_bound = 0;
   
-  gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.translation),
-    G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
+  // The camera's position is stored as placed in the editor, with z the other way.
+  eye[0] = camera->position->x;
+  eye[1] = camera->position->y;
+  eye[2] = -camera->position->z;
+}
+
+struct mesh *sos_select_lod(struct sos_model *model) {
+  struct mesh *mesh = model->lods;
+  float distance = 0, offset, margin;
   
-  gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.rotation),
-    G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_NOPUSH);
+  if(mesh->lower == NULL) return mesh;
   
-  gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.scale),
-    G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_NOPUSH);
+  // Measured from the middle of the bounds, scaled but not rotated.
+  offset = model->position->x + mesh->center[0] * model->scale->x - eye[0];
+  distance += offset * offset;
+  offset = model->position->y + mesh->center[1] * model->scale->y - eye[1];
+  distance += offset * offset;
+  offset = model->position->z + mesh->center[2] * model->scale->z - eye[2];
+  distance += offset * offset;
   
-  gDPPipeSync((*display_list)++);
+  // A level coarser than the one drawn last frame needs the camera a little further
+  // away and a finer one a little closer. Squared distances save the square root.
+  while(mesh->lower != NULL) {
+    margin = mesh->lower->level <= model->mesh->level ? 1 - LOD_HYSTERESIS : 1 + LOD_HYSTERESIS;
+    margin *= mesh->lower->lod_distance;
+    if(distance < margin * margin) break;
+    mesh = mesh->lower;
+  }
+  return mesh;
+}
+
+void sos_draw(struct sos_model *model, Gfx **display_list) {
+  if(!model->visible) return;
   
-  gDPSetCycleType((*display_list)++, G_CYC_1CYCLE);
-  gDPSetRenderMode((*display_list)++, G_RM_AA_ZB_OPA_SURF, G_RM_AA_ZB_OPA_SURF2);
-  gSPClearGeometryMode((*display_list)++, 0xFFFFFFFF);
-  gSPSetGeometryMode((*display_list)++, G_SHADE | G_SHADING_SMOOTH | G_ZBUFFER | G_CULL_FRONT);
+  model->mesh = sos_select_lod(model);
   
-  if(model->texture != NULL) {
-    gDPSetTextureFilter((*display_list)++, G_TF_BILERP);
-    gDPSetCombineMode((*display_list)++, G_CC_BLENDRGBA, G_CC_BLENDRGBA);
-    gDPSetTexturePersp((*display_list)++, G_TP_PERSP);
-    gSPTexture((*display_list)++, 0xffff, 0xffff, 0, G_TX_RENDERTILE, G_ON);
-    gDPLoadTextureBlock((*display_list)++, model->texture, G_IM_FMT_RGBA, G_IM_SIZ_16b, 32, 32, 0,
-      G_TX_WRAP, G_TX_WRAP, G_TX_NOMASK, G_TX_NOMASK, G_TX_NOLOD, G_TX_NOLOD);
-  }
+  guScale(&model->transform.scale, model->scale->x,
+    model->scale->y, model->scale->z);
   
-  // Send vertex data in batches of 30.
-  while(remaining_vertices >= 30) {
-    gSPVertex((*display_list)++, &(model->mesh->vertices[offset]), 30, 0);
-    gDPPipeSync((*display_list)++);
+  // Models left at the origin unrotated, like merged static geometry, only need their scale.
+  if(model->rotationAngle == 0 && model->position->x == 0 &&
+     model->position->y == 0 && model->position->z == 0) {
+    gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.scale),
+      G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
+  } else {
+    guTranslate(&model->transform.translation, model->position->x,
+      model->position->y, model->position->z);
     
-    for(i = 0; i < 30 / 3; i++) {
-      gSP1Triangle((*display_list)++, i * 3, i * 3 + 1, i * 3 + 2, 0);
-    }
+    guRotate(&model->transform.rotation, model->rotationAngle, 
+      model->rotationAxis->x, model->rotationAxis->y, model->rotationAxis->z);
+    
+    gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.translation),
+      G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_PUSH);
+    
+    gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.rotation),
+      G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_NOPUSH);
     
-    remaining_vertices -= 30;
-    offset += 30;
+    gSPMatrix((*display_list)++, OS_K0_TO_PHYSICAL(&model->transform.scale),
+      G_MTX_MODELVIEW | G_MTX_MUL | G_MTX_NOPUSH);
   }
   
-  // Process last remaining vertices.
-  if(remaining_vertices > 0) {
-    gSPVertex((*display_list)++, &(model->mesh->vertices[offset]), remaining_vertices, 0);
-    gDPPipeSync((*display_list)++);
-    
-    for(i = 0; i < remaining_vertices / 3; i++) {
-      gSP1Triangle((*display_list)++, i * 3, i * 3 + 1, i * 3 + 2, 0);
-    }
+  // Everything else was built at load so only calls are added each frame.
+  if(!state_bound || model->texture_list != bound_texture) {
+    gSPDisplayList((*display_list)++, OS_K0_TO_PHYSICAL(
+      model->texture_list != NULL ? model->texture_list : untextured_state));
+    bound_texture = model->texture_list;
+    state_bound = 1;
   }
   
+  gSPDisplayList((*display_list)++, OS_K0_TO_PHYSICAL(model->mesh->display_list));
+  
   gSPPopMatrix((*display_list)++, G_MTX_MODELVIEW);
 }
 
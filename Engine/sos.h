@@ -2,7 +2,6 @@
 #define _SOS_H_
 
 #include <nusys.h>
-#include "upng.h"
 
 #define SCREEN_WD 320
 #define SCREEN_HT 240
@@ -14,9 +13,30 @@ struct transform {
   Mtx rotation;
 };
 
+/* Written by the editor in front of each texture's texels. Format and size
+   hold the G_IM_FMT and G_IM_SIZ the texels are stored in, address holds
+   G_TX_WRAP, G_TX_MIRROR or G_TX_CLAMP and every mip level follows the one
+   before. Colour indexed textures name the asset holding their RGBA16 palette. */
+struct sos_texture_header {
+  u16 width;
+  u16 height;
+  u8 format;
+  u8 size;
+  u8 levels;
+  u8 address;
+  u16 palette_entries;
+  u16 palette_asset;
+  u16 texel_bytes;
+  u16 reserved;
+};
+
 struct sos_model {
   struct mesh *mesh;
-  unsigned short *texture;
+  struct mesh *lods;
+  void *texture;
+  struct sos_texture_header texture_info;
+  u16 *palette;
+  Gfx *texture_list;
   double rotationAngle;
   int visible;
   struct vector3 *position;
@@ -32,12 +52,56 @@ struct vector3 {
 struct mesh {
   int vertex_count;
   Vtx *vertices;
+  float bounds_min[3];
+  float bounds_max[3];
+  Gfx *display_list;
+  int level;
+  float lod_distance;
+  float center[3];
+  struct mesh *lower;
+};
+
+/* Written by the editor in front of each mesh's compressed geometry stream.
+   Vertex positions are quantized and multiplied by scale to get model units.
+   The vertices are grouped into batches that each fit the vertex buffer. Every
+   batch stores its vertex and triangle counts, its positions as offsets from
+   the smallest, its texture coordinates as differences from the vertex before
+   and three buffer slots for each triangle, all packed into bits. Coarser
+   levels of detail follow as whole meshes of their own, each drawn once the
+   camera is further than its distance. */
+struct sos_mesh_header {
+  u32 vertex_count;
+  f32 scale;
+  f32 bounds_min[3];
+  f32 bounds_max[3];
+  u32 batch_count;
+  u32 triangle_count;
+  f32 lod_distance;
+  u16 lod_count;
+  u16 reserved;
+  u32 stream_bytes;
 };
 
+struct sos_model *load_sos_model(void *data_start, void *data_end,
+	double positionX, double positionY, double positionZ,
+	double rotX, double rotY, double rotZ, double angle,
+	double scaleX, double scaleY, double scaleZ);
+
 struct sos_model *load_sos_model_with_texture(void *data_start, void *data_end,
 	void *texture_start, void *texture_end,
 	double positionX, double positionY, double positionZ,
 	double rotX, double rotY, double rotZ, double angle,
 	double scaleX, double scaleY, double scaleZ);
 
+Gfx *sos_build_mesh(struct mesh *mesh, u8 *table, int batch_count, int triangle_count);
+
+Gfx *sos_build_texture(struct sos_model *model);
+
+void sos_draw_begin(struct sos_model *camera);
+
+void sos_draw(struct sos_model *model, Gfx **display_list);
+
+struct sos_model *create_camera(double positionX, double positionY, double positionZ,
+	double rotX, double rotY, double rotZ, double angle);
+
 #endif
@@ -0,0 +1,8 @@
+#include "scene.h"
+
+struct sos_model *FindGameObjectByName(const char *name)
+{
+  struct nlist *np = lookup(name);
+  if(np == NULL) return NULL;
+  return _UER_Models[np->gameObjectIndex];
+}
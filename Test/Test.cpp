@@ -1,8 +1,44 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
 #include "Unit.h"
 #include "../Editor/Util.h"
+#include "../Editor/AssetBundle.h"
+#include "../Editor/BuildCache.h"
+#include "../Editor/BuildCore.h"
+#include "../Editor/BuildQueue.h"
+#include "../Editor/BuildReport.h"
+#include "../Editor/CompactVertices.h"
+#include "../Editor/DebugLines.h"
+#include "../Editor/FrameCost.h"
+#include "../Editor/GeometryCodec.h"
+#include "../Editor/MeshBatcher.h"
+#include "../Editor/MeshSimplifier.h"
+#include "../Editor/TaskGraph.h"
+#include "../Editor/TextureAtlas.h"
+#include "../Editor/TextureEncoder.h"
+#include "../Editor/Undo.h"
+#include "../Editor/ResourceManager.h"
+#include "../Editor/RomImage.h"
+#include "../Editor/StaticMerge.h"
 
 using namespace UltraEd;
 
+class CFakeAllocator : public CResourceAllocator
+{
+public:
+	bool Allocate(ResourceId id) { allocated.push_back(id); return true; }
+	void Free(ResourceId id) { freed.push_back(id); }
+	vector<ResourceId> allocated;
+	vector<ResourceId> freed;
+};
+
 int main()
 {
 	CUnit testRunner;
@@ -11,6 +47,723 @@ int main()
 		assert.Equal(CUtil::NewResourceName(26), "UER_26");
 	});
 
+	testRunner.It("evicts lower priority resources first when equally recent", [](CAssert assert) {
+		CFakeAllocator allocator;
+		CResourceManager manager(&allocator);
+		ResourceId gizmo = manager.Add(16, ResourcePriority::Normal);
+		ResourceId model = manager.Add(16, ResourcePriority::Normal);
+		manager.Use(gizmo);
+		manager.Use(model);
+		manager.SetPriority(gizmo, ResourcePriority::High);
+		manager.NextFrame();
+		manager.SetBudget(16);
+
+		assert.Equal(to_string(manager.GetState(gizmo)), to_string(ResourceState::Resident));
+		assert.Equal(to_string(manager.GetState(model)), to_string(ResourceState::Evicted));
+		assert.Equal(to_string(manager.Use(model)), "1");
+		assert.Equal(to_string(allocator.allocated.size()), "3");
+	});
+
+	testRunner.It("evicts least recently used resources over budget", [](CAssert assert) {
+		CFakeAllocator allocator;
+		CResourceManager manager(&allocator);
+		manager.SetBudget(32);
+		ResourceId first = manager.Add(16, ResourcePriority::Normal);
+		ResourceId second = manager.Add(16, ResourcePriority::Normal);
+		ResourceId third = manager.Add(16, ResourcePriority::Normal);
+		manager.Use(first);
+		manager.NextFrame();
+		manager.Use(second);
+		manager.NextFrame();
+		manager.Use(third);
+
+		assert.Equal(to_string(manager.GetResidentBytes()), "32");
+		assert.Equal(to_string(manager.GetState(first)), to_string(ResourceState::Evicted));
+		assert.Equal(to_string(allocator.freed.size()), "1");
+	});
+
+	testRunner.It("appends only new debug lines to the ring", [](CAssert assert) {
+		CDebugLines lines(8);
+		DebugVertex from = { 0, 0, 0 }, to = { 1, 1, 1 };
+		lines.AddLine(from, to, 10);
+		lines.AddLine(from, to, 10);
+		lines.Prepare(0);
+		lines.AddLine(from, to, 10);
+		lines.Prepare(1);
+
+		assert.Equal(to_string(lines.GetWrite().discard), "0");
+		assert.Equal(to_string(lines.GetWrite().start), "2");
+		assert.Equal(to_string(lines.GetWrite().count), "1");
+		assert.Equal(to_string(lines.GetRuns().size()), "1");
+		assert.Equal(to_string(lines.GetRuns()[0].count), "3");
+	});
+
+	testRunner.It("retires single frame debug lines after drawing", [](CAssert assert) {
+		CDebugLines lines(8);
+		DebugVertex from = { 0, 0, 0 }, to = { 1, 1, 1 };
+		lines.AddLine(from, to, 0);
+		lines.AddLine(from, to, 5);
+		lines.Prepare(0);
+		assert.Equal(to_string(lines.GetRuns()[0].count), "2");
+
+		lines.Prepare(1);
+		assert.Equal(to_string(lines.GetRuns()[0].start), "1");
+		assert.Equal(to_string(lines.GetRuns()[0].count), "1");
+
+		lines.Prepare(6);
+		assert.Equal(to_string(lines.GetRuns().size()), "0");
+		assert.Equal(to_string(lines.IsAnimating()), "0");
+	});
+
+	testRunner.It("rewrites live debug lines when the ring wraps", [](CAssert assert) {
+		CDebugLines lines(4);
+		DebugVertex min = { 0, 0, 0 }, max = { 1, 1, 1 };
+		lines.AddLine(min, max, 10);
+		lines.AddLine(min, max, 0);
+		lines.AddLine(min, max, 0);
+		lines.Prepare(0);
+		lines.AddLine(min, max, 10);
+		lines.AddLine(min, max, 10);
+		lines.Prepare(1);
+
+		assert.Equal(to_string(lines.GetWrite().discard), "1");
+		assert.Equal(to_string(lines.GetWrite().count), "3");
+		assert.Equal(to_string(lines.GetStaging().size()), "6");
+
+		lines.AddBox(min, max, 0);
+		lines.Prepare(2);
+		assert.Equal(to_string(lines.GetRuns()[0].count), "4");
+	});
+
+	testRunner.It("undoes and redoes steps in order", [](CAssert assert) {
+		CUndo undo;
+		int value = 0;
+		for (int i = 1; i <= 3; i++)
+		{
+			UndoStep step = { "", sizeof(int) };
+			step.undo = [&value, i]() { value = i - 1; };
+			step.redo = [&value, i]() { value = i; };
+			step.redo();
+			undo.Push(step);
+		}
+
+		undo.Undo();
+		undo.Undo();
+		assert.Equal(to_string(value), "1");
+
+		undo.Redo();
+		assert.Equal(to_string(value), "2");
+
+		UndoStep step = { "", sizeof(int) };
+		step.undo = [&value]() { value = 2; };
+		step.redo = [&value]() { value = 5; };
+		step.redo();
+		undo.Push(step);
+		assert.Equal(to_string(undo.CanRedo()), "0");
+	});
+
+	testRunner.It("collapses old steps to stay within the memory budget", [](CAssert assert) {
+		CUndo undo;
+		int value = 0;
+		for (int i = 1; i <= 4; i++)
+		{
+			UndoStep step = { "value", 1024 };
+			step.undo = [&value, i]() { value = i - 1; };
+			step.redo = [&value, i]() { value = i; };
+			step.redo();
+			undo.Push(step);
+		}
+
+		undo.SetBudget(undo.GetUsedBytes() - 1);
+		assert.Equal(to_string(undo.GetCount()), "3");
+
+		while (undo.Undo());
+		assert.Equal(to_string(value), "0");
+
+		while (undo.Redo());
+		assert.Equal(to_string(value), "4");
+	});
+
+	testRunner.It("quantizes vertices within a fraction of the mesh bounds", [](CAssert assert) {
+		float vertices[3][vertexFloats] = {
+			{ -2.0f, 0.5f, 10.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f },
+			{ 3.0f, -1.25f, 4.0f, 0.577f, -0.577f, -0.577f, 2.0f, 0.5f },
+			{ 0.3f, 0.0f, 7.7f, 0.0f, 0.0f, -1.0f, 1.25f, 1.0f }
+		};
+
+		CCompactVertices compact;
+		compact.Encode(&vertices[0][0], 3);
+		assert.Equal(to_string(compact.GetSize()), "36");
+
+		float positionError = 0, normalError = 0, uvError = 0;
+		for (int i = 0; i < 3; i++)
+		{
+			float decoded[vertexFloats];
+			compact.Decode(i, decoded);
+			for (int j = 0; j < 3; j++) positionError = fmaxf(positionError, fabsf(decoded[j] - vertices[i][j]));
+			for (int j = 3; j < 6; j++) normalError = fmaxf(normalError, fabsf(decoded[j] - vertices[i][j]));
+			for (int j = 6; j < 8; j++) uvError = fmaxf(uvError, fabsf(decoded[j] - vertices[i][j]));
+		}
+
+		assert.Equal(to_string(positionError < 0.0001f), "1");
+		assert.Equal(to_string(normalError < 0.02f), "1");
+		assert.Equal(to_string(uvError < 0.0001f), "1");
+	});
+
+	testRunner.It("skips build outputs whose inputs are unchanged", [](CAssert assert) {
+		const char *manifest = "build.cache.test";
+		const char *output = "build.output.test";
+		ContentHash inputs = CBuildCache::Hash(string("actor"));
+
+		CBuildCache cache(manifest);
+		assert.Equal(to_string(cache.IsCurrent(output, inputs)), "0");
+
+		CBuildCache::WriteIfChanged(output, "generated");
+		cache.Update(output, inputs);
+		cache.Save();
+
+		CBuildCache reloaded(manifest);
+		assert.Equal(to_string(reloaded.IsCurrent(output, inputs)), "1");
+		assert.Equal(to_string(reloaded.IsCurrent(output, CBuildCache::Hash(string("changed")))), "0");
+
+		remove(output);
+		assert.Equal(to_string(reloaded.IsCurrent(output, inputs)), "0");
+		remove(manifest);
+	});
+
+	testRunner.It("runs tasks after their dependencies", [](CAssert assert) {
+		CTaskGraph graph;
+		vector<int> results(8, 0);
+		vector<TaskId> assets;
+		for (int i = 0; i < 6; i++)
+		{
+			assets.push_back(graph.Add([&results, i]() { results[i] = i + 1; return true; }));
+		}
+
+		graph.Add([&results]() {
+			for (int i = 0; i < 6; i++) results[6] += results[i];
+			return true;
+		}, assets);
+		graph.Add([&results]() { results[7] = 1; return false; });
+		TaskId skipped = graph.Add([&results]() { results[7] = 2; return true; }, { 7 });
+
+		assert.Equal(to_string(graph.Run(4)), "0");
+		assert.Equal(to_string(results[6]), "21");
+		assert.Equal(to_string(results[7]), "1");
+		assert.Equal(to_string(skipped), "8");
+
+		// A dependency on a task that isn't added yet fails the graph before anything runs.
+		CTaskGraph misordered;
+		misordered.Add([&results]() { results[0] = 0; return true; }, { 1 });
+		misordered.Add([]() { return true; });
+		assert.Equal(to_string(misordered.Run()), "0");
+		assert.Equal(to_string(results[0]), "1");
+	});
+
+	testRunner.It("generates engine sources without the editor", [](CAssert assert) {
+		vector<BuildActor> actors(3);
+		actors[0].type = ActorType::Model;
+		actors[0].name = "Ship";
+		actors[0].texturePath = "ship.png";
+		actors[1].type = ActorType::Camera;
+		actors[1].name = "Camera";
+		actors[2].type = ActorType::Model;
+		actors[2].name = "Rock";
+
+		assert.Equal(CBuildCore::GenerateMappings(actors), "#include \"scene.h\"\n\n"
+			"void _UER_Mappings() {\n\tinsert(\"Ship\", 0);\n\tinsert(\"Camera\", 1);\n\tinsert(\"Rock\", 2);\n}");
+		assert.Equal(CBuildCore::GenerateActorList(actors), "ACTORFILES = UER_0.c UER_1.c UER_2.c\n");
+	});
+
+	testRunner.It("streams command output and exit codes", [](CAssert assert) {
+		CProcess process;
+		vector<string> lines;
+		int exitCode = process.Run("echo hello&& exit 3", ".", [&lines](const string &line) { lines.push_back(line); });
+
+		assert.Equal(to_string(exitCode), "3");
+		assert.Equal(to_string(lines.size()), "1");
+		assert.Equal(lines[0], "hello");
+	});
+
+	testRunner.It("coalesces builds requested while one is running", [](CAssert assert) {
+		atomic<bool> started(false), released(false);
+		BuildJob first, second, third;
+		BuildStage wait = { "Wait", [&started, &released](function<void(const string &)> output) {
+			started = true;
+			while (!released) this_thread::sleep_for(chrono::milliseconds(1));
+			return true;
+		} };
+		first.stages.push_back(wait);
+		first.success = "first";
+		second.success = "second";
+		third.success = "third";
+
+		CBuildQueue queue;
+		queue.Submit(first);
+		while (!started) this_thread::sleep_for(chrono::milliseconds(1));
+		queue.Submit(second);
+		queue.Submit(third);
+		released = true;
+		while (queue.IsBusy()) this_thread::sleep_for(chrono::milliseconds(1));
+
+		string finished;
+		BuildEvent event;
+		while (queue.Poll(&event))
+		{
+			if (event.type == BuildEventType::Finished) finished.append(event.text).append(" ");
+		}
+		assert.Equal(finished, "first third ");
+	});
+
+	testRunner.It("rewrites scripts in a single pass", [](CAssert assert) {
+		vector<BuildActor> actors(2);
+		actors[1].type = ActorType::Model;
+		actors[1].script = "void @update ()\n{\n\tself->visible = 0; // @start() self->\n\tmyself->name = \"self->\";\n}";
+
+		assert.Equal(CBuildCore::GenerateActorScript(actors[1], 1), "#include \"scene.h\"\n\n"
+			"void UER_1update ()\n{\n\t_UER_Models[1]->visible = 0; // @start() self->\n\tmyself->name = \"self->\";\n}\n");
+
+		string scripts = CBuildCore::GenerateScripts(actors);
+		assert.Equal(to_string(scripts.find("void UER_1update();") != string::npos), "1");
+		assert.Equal(to_string(scripts.find("start();") != string::npos), "0");
+	});
+
+	testRunner.It("packs identical assets once at aligned offsets", [](CAssert assert) {
+		CAssetBundle bundle(8);
+		int mesh = bundle.Add("mesh");
+		int texture = bundle.Add("texture");
+		int shared = bundle.Add("mesh");
+
+		assert.Equal(to_string(shared), to_string(mesh));
+		assert.Equal(to_string(bundle.GetEntries().size()), "2");
+		assert.Equal(to_string(bundle.GetEntries()[texture].offset), "8");
+		assert.Equal(to_string(bundle.GetData().size()), "15");
+	});
+
+	testRunner.It("assembles a ROM image with the boot checksum", [](CAssert assert) {
+		string base(0x1008, '\0');
+		for (size_t i = 0; i < base.size(); i++) base[i] = (char)(i * 7);
+
+		CRomImage rom(base);
+		unsigned int offset = rom.AddSegment("assets", "abc");
+		rom.SetWord(0x18, offset);
+
+		unsigned int crc1, crc2;
+		assert.Equal(to_string(CRomImage::Checksum(rom.GetData(), &crc1, &crc2)), "0");
+		assert.Equal(to_string(rom.Finalize()), "1");
+		assert.Equal(to_string(offset), "4112");
+		assert.Equal(to_string(rom.GetData().size()), "1179648");
+		assert.Equal(to_string(CRomImage::Checksum(rom.GetData(), &crc1, &crc2)), "1");
+		assert.Equal(to_string(crc1), "185642503");
+		assert.Equal(to_string(crc2), "342539464");
+		assert.Equal(rom.GetData().substr(0x10, 4), "\x0B\x10\xAE\x07");
+	});
+
+	testRunner.It("estimates heap and display list use against budgets", [](CAssert assert) {
+		vector<BuildActor> actors(2);
+		actors[0].type = ActorType::Model;
+		actors[0].name = "Ship";
+		actors[0].texturePath = "ship.png";
+		actors[0].vertexCount = 36;
+		actors[0].loadedVertices = 24;
+		actors[0].batchCount = 1;
+		actors[0].triangleCommands = 6;
+		actors[0].meshAsset = 0;
+		actors[0].textureAsset = 1;
+		actors[0].textureLevels = 1;
+		actors[1].type = ActorType::Camera;
+		actors[1].name = "Camera";
+
+		vector<AssetEntry> assets = { { 0, 100 }, { 104, 2064 } };
+		BuildBudget budget = { 1024 * 1024, 2048, 2048 };
+		CBuildReport report(budget);
+		report.Analyze(actors, assets);
+
+		assert.Equal(to_string(report.GetActors()[0].romBytes), "2164");
+		assert.Equal(to_string(report.GetHeapBytes()), "3944");
+		assert.Equal(to_string(report.GetDisplayListCommands()), "23");
+		assert.Equal(to_string(CBuildReport::MeshListCommands(actors[0])), "8");
+		assert.Equal(to_string(report.GetWarnings().size()), "1");
+		assert.Equal(report.GetWarnings()[0], "The scene needs about 3944 bytes of heap but the budget is 2048.");
+	});
+
+	testRunner.It("ranks actors by their estimated frame cost per camera", [](CAssert assert) {
+		vector<BuildActor> actors(3);
+		actors[0].type = ActorType::Camera;
+		actors[0].name = "Camera";
+		actors[1].type = ActorType::Model;
+		actors[1].name = "Far";
+		actors[2].type = ActorType::Model;
+		actors[2].name = "Near";
+		for (auto &actor : actors)
+		{
+			actor.angle = 0;
+			actor.vertexCount = actor.loadedVertices = 30;
+			actor.batchCount = 1;
+			actor.triangleCommands = 5;
+			for (int i = 0; i < 3; i++)
+			{
+				actor.position[i] = actor.axis[i] = 0;
+				actor.scale[i] = actor.boundsMax[i] = 1;
+				actor.boundsMin[i] = -1;
+			}
+		}
+		actors[1].position[2] = 50;
+		actors[2].position[2] = 5;
+
+		CFrameCost cost;
+		cost.Analyze(actors);
+		const CameraCost &camera = cost.GetCameras()[0];
+
+		assert.Equal(camera.actors[0].name, "Near");
+		assert.Equal(to_string((int)camera.actors[0].fillPixels), "6817");
+		assert.Equal(to_string(camera.commands), "30");
+		assert.Equal(to_string(camera.triangles), "20");
+		assert.Equal(to_string(cost.GetWarnings().size()), "0");
+	});
+
+	testRunner.It("encodes meshes as compressed streams of quantized vertices", [](CAssert assert) {
+		BuildActor actor = BuildActor();
+		actor.textureWidth = actor.textureHeight = 32;
+		actor.loadVertices = [](vector<float> &vertices) {
+			// Two triangles sharing an edge.
+			const float corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+			vertices.assign(6 * vertexFloats, 0.0f);
+			for (int i = 0; i < 6; i++)
+			{
+				vertices[i * vertexFloats] = 1.5f * corners[i][0];
+				vertices[i * vertexFloats + 1] = -2.0f * corners[i][1];
+				vertices[i * vertexFloats + 2] = 3.0f;
+				vertices[i * vertexFloats + 6] = 0.5f * corners[i][0];
+				vertices[i * vertexFloats + 7] = corners[i][1];
+			}
+			return true;
+		};
+
+		vector<float> vertices;
+		actor.loadVertices(vertices);
+		CBuildCore::MeasureMesh(actor);
+		string mesh = CBuildCore::EncodeMesh(actor, vertices);
+
+		assert.Equal(to_string(actor.loadedVertices) + " " + to_string(actor.triangleCommands), "4 1");
+		assert.Equal(to_string(mesh.size()), "74");
+		assert.Equal(mesh.substr(0, 8), string("\0\0\0\x04\x3A\x80\0\0", 8));
+		assert.Equal(mesh.substr(32, 8), string("\0\0\0\x01\0\0\0\x02", 8));
+
+		// The stream decodes back to the Vtx coordinates and batch table the engine builds from.
+		vector<short> decoded;
+		vector<unsigned char> table;
+		assert.Equal(to_string(CGeometryCodec::Decode(mesh.substr(52), 1, &decoded, &table)), "1");
+		string second;
+		for (int i = 0; i < codecShorts; i++) second.append(to_string(decoded[codecShorts * 2 + i])).append(" ");
+		assert.Equal(second, "1536 -2048 -3072 512 1024 ");
+		assert.Equal(string(table.begin(), table.end()), string("\x04\x02\0\x01\x02\0\x02\x03", 8));
+	});
+
+	testRunner.It("encodes textures in the smallest native format that fits", [](CAssert assert) {
+		const unsigned char gray[] = { 0, 0, 0, 255, 17, 17, 17, 255, 34, 34, 34, 255, 255, 255, 255, 255 };
+		const unsigned char red[] = { 255, 0, 0, 255 };
+
+		TextureOptions options = { TextureFormat::Auto, true, TextureAddress::Wrap, MipFilter::None };
+
+		assert.Equal(to_string(CTextureEncoder::SelectFormat(gray, 2, 2)), to_string(TextureFormat::I4));
+		assert.Equal(CTextureEncoder::Encode(gray, 2, 2, options),
+			string("\0\x02\0\x02\x04\0\x01\0\0\0\0\0\0\x02\0\0\x01\x2F", 18));
+		options.dither = false;
+		assert.Equal(CTextureEncoder::Encode(red, 1, 1, options).substr(4), string("\0\x02\x01\0\0\0\0\0\0\x02\0\0\xF8\x01", 14));
+	});
+
+	testRunner.It("indexes colour textures and shares palettes between them", [](CAssert assert) {
+		unsigned char first[8 * 8 * 4], second[8 * 8 * 4], third[8 * 8 * 4];
+		for (int i = 0; i < 8 * 8; i++)
+		{
+			const unsigned char red[] = { 255, 0, 0, 255 }, blue[] = { 0, 0, 255, 255 }, green[] = { 0, 255, 0, 255 };
+			memcpy(&first[i * 4], i % 3 == 0 ? blue : red, 4);
+			memcpy(&second[i * 4], i % 5 == 0 ? red : blue, 4);
+			memcpy(&third[i * 4], i % 2 == 0 ? green : red, 4);
+		}
+		first[3] = 0;
+
+		TextureOptions options = { TextureFormat::Auto, true, TextureAddress::Wrap, MipFilter::None };
+		vector<string> textures = {
+			CTextureEncoder::Encode(first, 8, 8, options),
+			CTextureEncoder::Encode(second, 8, 8, options),
+			CTextureEncoder::Encode(third, 8, 8, options)
+		};
+
+		assert.Equal(to_string(textures[0].size()), "80");
+		assert.Equal(textures[0].substr(4, 8), string("\x02\0\x01\0\0\x10\0\0", 8));
+		assert.Equal(textures[0].substr(48, 6), string("\0\0\x00\x3F\xF8\x01", 6));
+		assert.Equal(to_string(CTextureEncoder::SharePalettes(textures)), "1");
+		assert.Equal(textures[1].substr(48), textures[0].substr(48));
+		assert.Equal(to_string(textures[1][16] & 0xFF), "33");
+	});
+
+	testRunner.It("fits textures and their mip chains into TMEM", [](CAssert assert) {
+		int width, height;
+		CTextureEncoder::FitSize(300, 100, &width, &height);
+		assert.Equal(to_string(width) + "x" + to_string(height), "256x64");
+		assert.Equal(to_string(CTextureEncoder::LevelCount(TextureFormat::RGBA16, 32, 32, MipFilter::Box)), "4");
+		assert.Equal(to_string(CTextureEncoder::LevelCount(TextureFormat::RGBA32, 32, 32, MipFilter::Box)), "1");
+		assert.Equal(to_string(CTextureEncoder::TmemBytes(TextureFormat::RGBA16, 32, 32, 4)), "2720");
+		assert.Equal(to_string(CTextureEncoder::FitsTmem(TextureFormat::RGBA16, 64, 32, 4)), "0");
+		assert.Equal(to_string(CTextureEncoder::FitsTmem(TextureFormat::CI8, 32, 32, 3)), "1");
+
+		// A black and white stripe averages to grey unless the edge is clamped or mirrored.
+		const unsigned char stripe[] = { 0, 0, 0, 255, 0, 0, 0, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+		assert.Equal(to_string(CTextureEncoder::Downsample(stripe, 4, 1, MipFilter::Box, TextureAddress::Wrap)[4]), "255");
+		vector<unsigned char> wrapped = CTextureEncoder::Downsample(stripe, 4, 1, MipFilter::Kaiser, TextureAddress::Wrap);
+		vector<unsigned char> clamped = CTextureEncoder::Downsample(stripe, 4, 1, MipFilter::Kaiser, TextureAddress::Clamp);
+		assert.Equal(to_string(wrapped[0]) + " " + to_string(clamped[0]), "38 16");
+
+		vector<unsigned char> image;
+		for (int i = 0; i < 8; i++) image.insert(image.end(), stripe, stripe + sizeof(stripe));
+		TextureOptions options = { TextureFormat::RGBA16, false, TextureAddress::Clamp, MipFilter::Box };
+		string texture = CTextureEncoder::Encode(&image[0], 8, 4, options);
+		assert.Equal(to_string(texture[6]) + " " + to_string(texture[7]), "2 2");
+		assert.Equal(to_string(texture.size()), "96");
+	});
+
+	testRunner.It("packs small textures into shared atlases", [](CAssert assert) {
+		CSkylinePacker packer(8, 8);
+		AtlasRect rect;
+		packer.Insert(4, 4, &rect);
+		packer.Insert(4, 2, &rect);
+		assert.Equal(to_string(rect.x) + " " + to_string(rect.y), "4 0");
+		packer.Insert(4, 2, &rect);
+		assert.Equal(to_string(rect.x) + " " + to_string(rect.y), "4 2");
+		assert.Equal(to_string(packer.Insert(8, 4, &rect)), "1");
+		assert.Equal(to_string(rect.x) + " " + to_string(rect.y), "0 4");
+		assert.Equal(to_string(packer.Insert(1, 1, &rect)), "0");
+
+		// Two small textures share an atlas while one filling TMEM is left alone.
+		TextureOptions options = { TextureFormat::RGBA16, false, TextureAddress::Wrap, MipFilter::None };
+		vector<unsigned char> red(8 * 8 * 4, 255), blue(8 * 4 * 4, 255), large(64 * 32 * 4, 255);
+		for (size_t i = 0; i < red.size(); i += 4) red[i + 1] = red[i + 2] = 0;
+		for (size_t i = 0; i < blue.size(); i += 4) blue[i] = blue[i + 1] = 0;
+		vector<string> textures = {
+			CTextureEncoder::Encode(&red[0], 8, 8, options),
+			CTextureEncoder::Encode(&large[0], 64, 32, options),
+			CTextureEncoder::Encode(&blue[0], 8, 4, options)
+		};
+		assert.Equal(to_string(CTextureAtlas::IsCandidate(textures[1])), "0");
+
+		vector<TextureAtlas> atlases = CTextureAtlas::Pack(textures);
+		assert.Equal(to_string(atlases.size()) + " " + to_string(atlases[0].members.size()), "1 2");
+		assert.Equal(to_string(atlases[0].members[1]), "2");
+		const AtlasRect &region = atlases[0].regions[1];
+		assert.Equal(to_string(region.x) + " " + to_string(region.y), "11 1");
+
+		// The border around each texture repeats its edge texels.
+		const string &atlas = atlases[0].texture;
+		assert.Equal(to_string(atlas.size()), to_string(16 + 64 * 32 * 2));
+		assert.Equal(to_string((int)atlas[6]) + " " + to_string((int)atlas[7]), "1 2");
+		size_t corner = 16 + ((region.y - 1) * 64 + region.x - 1) * 2;
+		assert.Equal(to_string((unsigned char)atlas[corner]) + " " + to_string((unsigned char)atlas[corner + 1]), "0 63");
+	});
+
+	testRunner.It("batches shared vertices into loads of the vertex buffer", [](CAssert assert) {
+		// A 16 by 16 grid of quads sends 1536 vertices without batching.
+		const int size = 16;
+		vector<float> vertices;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+				for (auto corner : corners)
+				{
+					float vertex[vertexFloats] = { (float)(x + corner[0]), (float)(y + corner[1]), 0, 0, 0, 1, 0, 0 };
+					vertices.insert(vertices.end(), vertex, vertex + vertexFloats);
+				}
+			}
+		}
+
+		vector<int> indices, sources;
+		CMeshBatcher::Weld(vertices, &indices, &sources);
+		assert.Equal(to_string(sources.size()), "289");
+
+		vector<MeshBatch> batches = CMeshBatcher::Build(indices, (int)sources.size());
+		size_t triangles = 0, largest = 0;
+		for (auto &batch : batches)
+		{
+			triangles += batch.triangles.size() / 3;
+			largest = max(largest, batch.vertices.size());
+		}
+		assert.Equal(to_string(triangles), "512");
+		assert.Equal(to_string(largest), "32");
+		assert.Equal(to_string(CMeshBatcher::LoadedVertices(batches)), "405");
+		assert.Equal(to_string(CMeshBatcher::TriangleCommands(batches)), "259");
+	});
+
+	testRunner.It("merges static models into baked meshes for each texture and cell", [](CAssert assert) {
+		const char *names[6] = { "Camera", "Crate A", "Crate B", "Crate C", "Door", "Floor" };
+		const float offsets[6] = { 0, 10, -10, 10, 0, 0 };
+		vector<BuildActor> actors(6);
+		for (int i = 0; i < 6; i++)
+		{
+			actors[i].type = i == 0 ? ActorType::Camera : ActorType::Model;
+			actors[i].name = names[i];
+			actors[i].isStatic = true;
+			actors[i].position[0] = offsets[i];
+			actors[i].axis[2] = 1;
+			actors[i].scale[0] = actors[i].scale[1] = actors[i].scale[2] = 1;
+			actors[i].meshPath = string(names[i]).append(".rom.vtx");
+			actors[i].texturePath = i < 4 ? "crate.png" : "";
+			actors[i].loadVertices = [](vector<float> &vertices) {
+				const float corners[3][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 } };
+				vertices.assign(3 * vertexFloats, 0.0f);
+				for (int i = 0; i < 3; i++)
+				{
+					vertices[i * vertexFloats] = corners[i][0];
+					vertices[i * vertexFloats + 1] = corners[i][1];
+					vertices[i * vertexFloats + 5] = 1;
+				}
+				return true;
+			};
+		}
+		actors[2].angle = 90;
+		actors[3].position[2] = 1;
+		actors[4].script = "void @update()\n{\n\tself->position->x += 1;\n}";
+		actors[5].script = "void @start()\n{\n\n}\n\n// Nothing to do.\nvoid @update()\n{\n}";
+
+		assert.Equal(to_string(CStaticMerge::CanMerge(actors[4])), "0");
+		assert.Equal(to_string(CStaticMerge::CanMerge(actors[5])), "1");
+		assert.Equal(to_string(CStaticMerge::Merge(actors, 2)), "1");
+
+		string merged;
+		for (auto &actor : actors) merged.append(actor.name).append(";");
+		assert.Equal(merged, "Camera;Door;Floor;Crate B;Static 2;");
+		assert.Equal(actors[3].meshPath, "static1.rom.vtx");
+		assert.Equal(to_string(CBuildReport::DrawCommands(actors[4], false)), "3");
+
+		// Crate B was turned a quarter about z before moving so its second corner points up.
+		vector<float> vertices;
+		actors[3].loadVertices(vertices);
+		assert.Equal(to_string(vertices[vertexFloats]) + " " + to_string(vertices[vertexFloats + 1]), "-10.000000 1.000000");
+		actors[4].loadVertices(vertices);
+		assert.Equal(to_string(vertices.size() / vertexFloats), "6");
+		assert.Equal(to_string(vertices[2] + vertices[3 * vertexFloats + 2]), "1.000000");
+
+		// Pieces a script looks up by name stay actors of their own.
+		vector<BuildActor> lookedUp = { actors[3], actors[3], actors[0] };
+		lookedUp[0].name = "Crate A";
+		lookedUp[2].script = "void @start()\n{\n\tFindGameObjectByName(\"Crate A\");\n}";
+		assert.Equal(to_string(CStaticMerge::Merge(lookedUp)), "1");
+		merged.clear();
+		for (auto &actor : lookedUp) merged.append(actor.name).append(";");
+		assert.Equal(merged, "Crate A;Camera;Crate B;");
+	});
+
+	testRunner.It("simplifies meshes into coarser levels of detail", [](CAssert assert) {
+		// A bumpy 16 by 16 grid keeps its outline while its inside is simplified.
+		const int size = 16;
+		vector<float> vertices;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+				for (auto corner : corners)
+				{
+					int u = x + corner[0], v = y + corner[1];
+					float vertex[vertexFloats] = { (float)u, (float)v, (u * 7 + v * 3) % 5 == 0 ? 0.1f : 0, 0, 0, 1, 0, 0 };
+					vertices.insert(vertices.end(), vertex, vertex + vertexFloats);
+				}
+			}
+		}
+
+		vector<float> simplified = CMeshSimplifier::Simplify(vertices, 128);
+		size_t triangles = simplified.size() / vertexFloats / 3;
+		float low[2] = { 0, 0 }, high[2] = { 0, 0 };
+		for (size_t i = 0; i < simplified.size(); i += vertexFloats)
+		{
+			for (int axis = 0; axis < 2; axis++)
+			{
+				low[axis] = min(low[axis], simplified[i + axis]);
+				high[axis] = max(high[axis], simplified[i + axis]);
+			}
+		}
+		assert.Equal(to_string(triangles <= 128 && triangles > 64), "1");
+		assert.Equal(to_string(low[0]) + " " + to_string(high[0]) + " " + to_string(low[1]) + " " + to_string(high[1]),
+			"0.000000 16.000000 0.000000 16.000000");
+
+		BuildActor actor = BuildActor();
+		actor.vertexCount = 1536;
+		MeshLevel full = { 0, 512, 405, 13, 259 }, half = { 40, 256, 200, 7, 130 }, quarter = { 80, 128, 100, 4, 65 };
+		actor.lods = { full, half, quarter };
+		assert.Equal(to_string(CBuildCore::LevelAt(actor, 10).triangles), "512");
+		assert.Equal(to_string(CBuildCore::LevelAt(actor, 50).triangles), "256");
+		assert.Equal(to_string(CBuildCore::LevelAt(actor, 500).triangles), "128");
+		assert.Equal(to_string(CBuildReport::MeshListCommands(actor)), "273");
+
+		// Rescaling a model moves its switch distances even though its vertices are unchanged.
+		vector<BuildActor> scene(1, BuildActor());
+		BuildActor &model = scene[0];
+		model.type = ActorType::Model;
+		model.name = "Grid";
+		model.meshPath = "lod.test.rom.vtx";
+		model.lodLevels = 3;
+		model.axis[2] = 1;
+		model.scale[0] = model.scale[1] = model.scale[2] = 1;
+		model.loadVertices = [vertices](vector<float> &loaded) { loaded = vertices; return true; };
+
+		CBuildCache cache("lod.test.cache");
+		CBuildCore::Generate(scene, "lod.test.", cache);
+		float nearScale = scene[0].lods[1].distance;
+		model.scale[0] = 2;
+		CBuildCore::Generate(scene, "lod.test.", cache);
+		assert.Equal(to_string(scene[0].lods[1].distance / nearScale), "2.000000");
+
+		const char *outputs[] = { "rom.vtx", "cache", "spec", "models.c", "assets.c", "assets.bin", "cameras.c",
+			"scripts.c", "mappings.c", "actors.mk", "UER_0.c" };
+		for (auto output : outputs) remove(string("lod.test.").append(output).c_str());
+	});
+
+	testRunner.It("compresses batched geometry to a fraction of its Vtx arrays", [](CAssert assert) {
+		// A 16 by 16 grid with coordinates across it, quantized like EncodeMesh does.
+		const int size = 16;
+		vector<float> vertices;
+		for (int y = 0; y < size; y++)
+		{
+			for (int x = 0; x < size; x++)
+			{
+				const int corners[6][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 0 }, { 1, 1 }, { 0, 1 } };
+				for (auto corner : corners)
+				{
+					float u = (float)(x + corner[0]), v = (float)(y + corner[1]);
+					float vertex[vertexFloats] = { u, v, 0, 0, 0, 1, u / size, v / size };
+					vertices.insert(vertices.end(), vertex, vertex + vertexFloats);
+				}
+			}
+		}
+
+		vector<int> indices, sources;
+		CMeshBatcher::Weld(vertices, &indices, &sources);
+		vector<MeshBatch> batches = CMeshBatcher::Build(indices, (int)sources.size());
+		vector<short> quantized;
+		for (auto &batch : batches)
+		{
+			for (auto vertex : batch.vertices)
+			{
+				const float *source = &vertices[sources[vertex] * vertexFloats];
+				short values[codecShorts] = { (short)(source[0] * 1024), (short)(source[1] * 1024), 0,
+					(short)(source[6] * 32 * 32), (short)(source[7] * 32 * 32) };
+				quantized.insert(quantized.end(), values, values + codecShorts);
+			}
+		}
+
+		string stream = CGeometryCodec::Encode(batches, quantized);
+		size_t raw = CMeshBatcher::LoadedVertices(batches) * 16 + batches.size() * 2 + 512 * 3;
+		assert.Equal(to_string(raw) + " " + to_string(stream.size()), "8042 1670");
+
+		vector<short> decoded;
+		vector<unsigned char> table;
+		assert.Equal(to_string(CGeometryCodec::Decode(stream, (int)batches.size(), &decoded, &table)), "1");
+		assert.Equal(to_string(decoded == quantized), "1");
+		assert.Equal(to_string(table[batches.size() * 2 + 5]), to_string(batches[0].triangles[5]));
+	});
+
 	testRunner.Run();
 
 	return 0;